@@ -19,6 +19,5155 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QCheckBox>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QFile>
+#include <QEventLoop>
+#include <QTextStream>
+#include <QTimer>
+#include <QDateTime>
+#include <QSet>
+#include <QSignalBlocker>
+#include <algorithm>
+#include <climits>
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QUrlQuery>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStorageInfo>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QTableView>
+#include <QHeaderView>
+#include <QAbstractTableModel>
+#include <QBitArray>
+#include <QVector>
+#include <QMap>
+#include <QSortFilterProxyModel>
+#include <QCache>
+#include <QImage>
+#include <QImageReader>
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QListWidget>
+#include <QTemporaryFile>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#include <cerrno>
+#include <csignal>
+#endif
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+// ProcessPriority: Scheduling class for child processes: nice level, I/O class and CPU set.
+// Applied in the child before exec, so yt-dlp and every ffmpeg it starts inherit it.
+struct ProcessPriority {
+    // IoClass: Linux I/O scheduling classes (IOPRIO_CLASS_*).
+    enum IoClass { IoNone = 0, IoRealtime = 1, IoBestEffort = 2, IoIdle = 3 };
+
+    QString name = "interactive"; // Class name shown to the user
+    int nice = 0; // Nice level, -20 (highest) to 19
+    IoClass ioClass = IoBestEffort; // I/O scheduling class
+    int ioLevel = 4; // Level within the I/O class, 0 (highest) to 7
+    QList<int> cpus; // Allowed CPUs, empty for all
+    double bandwidthWeight = 3; // Share of the bandwidth budget relative to other classes
+
+    // named: The settings of a class; YTDLP_GUI_<CLASS>_CPUS (e.g. "2-3,6") sets its CPU mask.
+    static ProcessPriority named(const QString &name) {
+        ProcessPriority priority;
+        priority.name = name;
+        if (name == "bulk") {
+            priority.nice = 10;
+            priority.ioLevel = 7;
+            priority.bandwidthWeight = 1;
+        }
+        QString cpuList = qEnvironmentVariable(QString("YTDLP_GUI_%1_CPUS").arg(name.toUpper()).toLatin1().constData());
+        for (const QString &part : cpuList.split(',', Qt::SkipEmptyParts)) {
+            int first = part.section('-', 0, 0).toInt();
+            int last = part.contains('-') ? part.section('-', 1, 1).toInt() : first;
+            for (int cpu = first; cpu <= last; ++cpu) priority.cpus << cpu;
+        }
+        return priority;
+    }
+    bool operator==(const ProcessPriority &other) const {
+        return name == other.name && nice == other.nice && ioClass == other.ioClass
+            && ioLevel == other.ioLevel && cpus == other.cpus && bandwidthWeight == other.bandwidthWeight;
+    }
+};
+
+// cpuListText: Formats CPU numbers as a list of ranges, e.g. "0-3,6".
+static QString cpuListText(const QList<int> &cpus) {
+    QStringList ranges;
+    for (int i = 0; i < cpus.size();) {
+        int j = i;
+        while (j + 1 < cpus.size() && cpus.at(j + 1) == cpus.at(j) + 1) ++j;
+        ranges << (i == j ? QString::number(cpus.at(i)) : QString("%1-%2").arg(cpus.at(i)).arg(cpus.at(j)));
+        i = j + 1;
+    }
+    return ranges.join(',');
+}
+
+// effectivePriority: Reads back the scheduling settings a running process actually has.
+// Raising priority can be refused without privileges, so this may differ from the class.
+static QString effectivePriority(qint64 pid) {
+    QStringList parts;
+#ifdef Q_OS_UNIX
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, id_t(pid));
+    if (errno == 0) parts << QString("nice %1").arg(nice);
+#endif
+#ifdef Q_OS_LINUX
+    static const char *ioClasses[] = {"none", "realtime", "best-effort", "idle"};
+    long ioprio = syscall(SYS_ioprio_get, 1 /* IOPRIO_WHO_PROCESS */, int(pid));
+    if (ioprio >= 0) parts << QString("I/O %1 %2").arg(ioClasses[(ioprio >> 13) & 3]).arg(ioprio & 0xff);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(pid_t(pid), sizeof(set), &set) == 0) {
+        QList<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) if (CPU_ISSET(cpu, &set)) cpus << cpu;
+        parts << "CPUs " + cpuListText(cpus);
+    }
+#endif
+    Q_UNUSED(pid);
+    return parts.isEmpty() ? QString("default") : parts.join(", ");
+}
+
+// signalProcessTree: Sends a signal to a process and all of its descendants (Linux).
+static void signalProcessTree(qint64 pid, int signal) {
+#ifdef Q_OS_UNIX
+    // Children are listed per thread in /proc/<pid>/task/<tid>/children
+    QDir threads(QString("/proc/%1/task").arg(pid));
+    for (const QString &tid : threads.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QFile children(threads.filePath(tid + "/children"));
+        if (!children.open(QIODevice::ReadOnly)) continue;
+        for (const QByteArray &child : children.readAll().split(' ')) {
+            qint64 childPid = child.trimmed().toLongLong();
+            if (childPid > 0) signalProcessTree(childPid, signal);
+        }
+    }
+    ::kill(pid_t(pid), signal);
+#else
+    Q_UNUSED(pid);
+    Q_UNUSED(signal);
+#endif
+}
+
+// ChildProcess: QProcess that applies a ProcessPriority and cgroup to the child between fork
+// and exec. Nice level, I/O priority, CPU affinity and cgroup membership are inherited across
+// exec and fork, so they cover the whole process tree the child starts.
+class ChildProcess : public QProcess {
+public:
+    // Constructor: Prepares the settings so the child only makes plain system calls.
+    ChildProcess(const ProcessPriority &priority, QObject *parent = nullptr) : QProcess(parent), settings(priority) {
+#ifdef Q_OS_LINUX
+        CPU_ZERO(&cpuMask);
+        for (int cpu : priority.cpus) if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &cpuMask);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        setChildProcessModifier([this] { setupChild(); });
+#endif
+    }
+    // priority: The class the child was started with.
+    const ProcessPriority &priority() const { return settings; }
+    // setCgroup: Makes the child join a cgroup directory before exec; empty to stay put.
+    void setCgroup(const QString &path) { cgroupProcs = path.isEmpty() ? QByteArray() : QFile::encodeName(path + "/cgroup.procs"); }
+
+protected:
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    // setupChildProcess: Runs in the child after fork (Qt 5).
+    void setupChildProcess() override { setupChild(); }
+#endif
+
+private:
+    // setupChild: Runs in the forked child; failures leave the inherited settings.
+    void setupChild() {
+#ifdef Q_OS_UNIX
+        setpriority(PRIO_PROCESS, 0, settings.nice);
+#endif
+#ifdef Q_OS_LINUX
+        // Writing "0" to cgroup.procs moves the writing process
+        if (!cgroupProcs.isEmpty()) {
+            int fd = ::open(cgroupProcs.constData(), O_WRONLY);
+            if (fd >= 0) {
+                ssize_t written = ::write(fd, "0", 1);
+                Q_UNUSED(written);
+                ::close(fd);
+            }
+        }
+        syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, 0, (int(settings.ioClass) << 13) | settings.ioLevel);
+        if (!settings.cpus.isEmpty()) sched_setaffinity(0, sizeof(cpuMask), &cpuMask);
+#endif
+    }
+
+    ProcessPriority settings; // Class applied to the child
+    QByteArray cgroupProcs; // cgroup.procs file the child joins, empty for none
+#ifdef Q_OS_LINUX
+    cpu_set_t cpuMask; // settings.cpus as an affinity mask
+#endif
+};
+
+// CgroupUsage: Resources used by the processes of one cgroup.
+struct CgroupUsage {
+    bool valid = false; // Read from a cgroup
+    double cpuSeconds = 0; // usage_usec of cpu.stat
+    qint64 memoryPeak = 0; // memory.peak, or memory.current on kernels without it
+    qint64 ioBytes = 0; // Bytes read plus written according to io.stat
+
+    // add: Accumulates another measurement; memory keeps the larger peak.
+    void add(const CgroupUsage &other) {
+        if (!other.valid) return;
+        valid = true;
+        cpuSeconds += other.cpuSeconds;
+        memoryPeak = qMax(memoryPeak, other.memoryPeak);
+        ioBytes += other.ioBytes;
+    }
+    // text: Short summary for the output, e.g. "CPU 12.3 s, memory 240 MB, I/O 1.2 GB".
+    QString text() const {
+        auto mb = [](qint64 bytes) { return QString("%1 MB").arg(bytes / double(1 << 20), 0, 'f', 0); };
+        return QString("CPU %1 s, memory %2, I/O %3").arg(cpuSeconds, 0, 'f', 1).arg(mb(memoryPeak), mb(ioBytes));
+    }
+};
+
+// CgroupTree: Places child processes in cgroup v2 groups below a delegated subtree.
+// Layout: <root>/gui holds this process, <root>/class-<priority> carries the class
+// limits and <root>/class-<priority>/<job> the per-job limits and usage. Limits come
+// from YTDLP_GUI_<CLASS>_{MEMORY,CPU,IO}_MAX and YTDLP_GUI_JOB_{MEMORY,CPU,IO}_MAX in
+// the kernel's formats ("4G", "200000 100000", "8:0 wbps=52428800"); bulk defaults to
+// half the cores. Without a writable cgroup v2 subtree every call is a no-op.
+class CgroupTree {
+public:
+    // shared: The process-wide tree; call it before starting any child.
+    static CgroupTree &shared() {
+        static CgroupTree tree;
+        return tree;
+    }
+    // isAvailable: True when groups can be created and joined.
+    bool isAvailable() const { return available; }
+    // status: Where groups are created, or why they are not.
+    QString status() const { return statusText; }
+    // group: Creates a job group below its priority class group; empty when unavailable.
+    QString group(const ProcessPriority &priority, const QString &name);
+    // freeze: Stops or resumes every process of a group; false when that is not possible.
+    bool freeze(const QString &path, bool frozen) {
+        return !path.isEmpty() && writeFile(path + "/cgroup.freeze", frozen ? "1" : "0");
+    }
+    // remove: Deletes a job group once its processes have exited.
+    void remove(const QString &path) { if (!path.isEmpty()) QDir().rmdir(path); }
+    // usage: Reads the cpu, memory and io statistics of a group.
+    static CgroupUsage usage(const QString &path);
+
+private:
+    // Constructor: Finds a delegated subtree and enables the controllers below it.
+    CgroupTree();
+    // applyLimits: Writes memory.max, cpu.max and io.max from the environment prefix.
+    void applyLimits(const QString &path, const QString &prefix, const QString &defaultCpuMax);
+    // readFile: Contents of a cgroup file, empty if unreadable.
+    static QByteArray readFile(const QString &path);
+    // writeFile: Writes one value to a cgroup file; false if the kernel refused it.
+    static bool writeFile(const QString &path, const QByteArray &value);
+
+    QString root; // Delegated subtree
+    QStringList controllers; // Controllers enabled below root
+    QSet<QString> classes; // Priority class groups already set up
+    QString statusText; // Shown once to the user
+    bool available = false; // Groups can be used
+};
+
+// Constructor implementation
+CgroupTree::CgroupTree() {
+#ifdef Q_OS_LINUX
+    QString own;
+    for (const QByteArray &line : readFile("/proc/self/cgroup").split('\n')) {
+        if (line.startsWith("0::")) own = "/sys/fs/cgroup" + QString::fromUtf8(line.mid(3));
+    }
+    if (own.isEmpty() || !QFile::exists(own + "/cgroup.controllers")) {
+        statusText = "cgroup v2 is not available; jobs run without resource limits";
+        return;
+    }
+    root = qEnvironmentVariable("YTDLP_GUI_CGROUP", own);
+    if (!QFileInfo(root + "/cgroup.procs").isWritable() || !QFileInfo(root + "/cgroup.subtree_control").isWritable()) {
+        statusText = QString("%1 is not delegated to this user; jobs run without resource limits").arg(root);
+        return;
+    }
+    // A group that hands controllers to children may not hold processes itself
+    if (root == own) {
+        QDir().mkpath(root + "/gui");
+        if (!writeFile(root + "/gui/cgroup.procs", QByteArray::number(QCoreApplication::applicationPid()))) {
+            statusText = QString("Cannot move into %1/gui; jobs run without resource limits").arg(root);
+            return;
+        }
+    }
+    QList<QByteArray> offered = readFile(root + "/cgroup.controllers").trimmed().split(' ');
+    for (const char *controller : {"cpu", "memory", "io"}) {
+        if (offered.contains(controller) && writeFile(root + "/cgroup.subtree_control", QByteArray("+") + controller)) {
+            controllers << controller;
+        }
+    }
+    available = true;
+    statusText = QString("Jobs run in cgroups below %1 (%2)").arg(root, controllers.isEmpty() ? "no controllers" : controllers.join(", "));
+#else
+    statusText = "cgroups are Linux-only; jobs run without resource limits";
+#endif
+}
+
+// group: Creates a job group below its priority class group; empty when unavailable.
+QString CgroupTree::group(const ProcessPriority &priority, const QString &name) {
+    if (!available) return QString();
+    QString classPath = root + "/class-" + priority.name;
+    if (!classes.contains(priority.name)) {
+        if (!QDir().mkpath(classPath)) return QString();
+        QString defaultCpuMax;
+        if (priority.name == "bulk") defaultCpuMax = QString("%1 100000").arg(qMax(1, QThread::idealThreadCount() / 2) * 100000);
+        applyLimits(classPath, "YTDLP_GUI_" + priority.name.toUpper(), defaultCpuMax);
+        for (const QString &controller : controllers) writeFile(classPath + "/cgroup.subtree_control", "+" + controller.toUtf8());
+        classes << priority.name;
+    }
+    QString path = classPath + "/" + name;
+    if (!QDir().mkpath(path)) return QString();
+    applyLimits(path, "YTDLP_GUI_JOB", QString());
+    return path;
+}
+
+// usage: Reads the cpu, memory and io statistics of a group.
+CgroupUsage CgroupTree::usage(const QString &path) {
+    CgroupUsage usage;
+    if (path.isEmpty()) return usage;
+    for (const QByteArray &line : readFile(path + "/cpu.stat").split('\n')) {
+        if (line.startsWith("usage_usec ")) {
+            usage.cpuSeconds = line.mid(11).toDouble() / 1e6;
+            usage.valid = true;
+        }
+    }
+    QByteArray memory = readFile(path + "/memory.peak").trimmed();
+    if (memory.isEmpty()) memory = readFile(path + "/memory.current").trimmed();
+    usage.memoryPeak = memory.toLongLong();
+    // Lines look like "8:0 rbytes=1459200 wbytes=314773504 rios=192 wios=353 ..."
+    for (const QByteArray &line : readFile(path + "/io.stat").split('\n')) {
+        for (const QByteArray &field : line.split(' ')) {
+            if (field.startsWith("rbytes=") || field.startsWith("wbytes=")) usage.ioBytes += field.mid(7).toLongLong();
+        }
+    }
+    return usage;
+}
+
+// applyLimits: Writes memory.max, cpu.max and io.max from the environment prefix.
+void CgroupTree::applyLimits(const QString &path, const QString &prefix, const QString &defaultCpuMax) {
+    auto limit = [&prefix](const char *name) {
+        return qEnvironmentVariable(QString("%1_%2_MAX").arg(prefix, name).toLatin1().constData());
+    };
+    QString memoryMax = limit("MEMORY"), cpuMax = limit("CPU"), ioMax = limit("IO");
+    if (cpuMax.isEmpty()) cpuMax = defaultCpuMax;
+    if (!memoryMax.isEmpty() && !writeFile(path + "/memory.max", memoryMax.toUtf8())) {
+        qWarning("Cannot set memory.max of %s", qPrintable(path));
+    }
+    if (!cpuMax.isEmpty() && !writeFile(path + "/cpu.max", cpuMax.toUtf8())) {
+        qWarning("Cannot set cpu.max of %s", qPrintable(path));
+    }
+    // io.max takes one "major:minor key=value..." line per device, separated by ";" here
+    for (const QString &device : ioMax.split(';', Qt::SkipEmptyParts)) {
+        if (!writeFile(path + "/io.max", device.trimmed().toUtf8())) qWarning("Cannot set io.max of %s", qPrintable(path));
+    }
+}
+
+// readFile: Contents of a cgroup file, empty if unreadable.
+QByteArray CgroupTree::readFile(const QString &path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+// writeFile: Writes one value to a cgroup file; false if the kernel refused it.
+bool CgroupTree::writeFile(const QString &path, const QByteArray &value) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) return false;
+    return file.write(value) == value.size();
+}
+
+// PressureMonitor: Samples Linux pressure stall information (/proc/pressure/{cpu,io,memory})
+// and turns it into an admission level. The level rises as soon as a resource's "some avg10"
+// stall share crosses its threshold and falls one step after three calm samples in a row.
+// Thresholds come from YTDLP_GUI_PSI_CPU, _IO and _MEMORY as "elevated,critical" percentages.
+class PressureMonitor : public QObject {
+    Q_OBJECT
+public:
+    // Level: How hard the machine is stalling; higher levels admit less work.
+    enum Level { Normal, Elevated, Critical };
+
+    // Constructor: Starts sampling every two seconds when PSI is available.
+    explicit PressureMonitor(QObject *parent = nullptr);
+    // isAvailable: False on kernels without PSI (or outside Linux); the level stays Normal.
+    bool isAvailable() const { return available; }
+    // level: The current level.
+    Level level() const { return current; }
+
+signals:
+    // sampled: Emitted after every sample so listeners can ramp gradually.
+    void sampled(PressureMonitor::Level level, const QString &reason);
+    // memoryPressureChanged: Emitted when memory stalls cross or fall below their elevated threshold.
+    void memoryPressureChanged(bool high);
+
+private slots:
+    // sample: Reads the pressure files and updates the level.
+    void sample();
+
+private:
+    // Threshold: Stall shares in percent at which a resource raises the level.
+    struct Threshold {
+        QString resource; // "cpu", "io" or "memory"
+        double elevated; // Throttle admission above this
+        double critical; // Pause bulk work above this
+    };
+
+    // stall: The "some avg10" value of a resource, -1 if unreadable.
+    static double stall(const QString &resource);
+
+    QList<Threshold> thresholds; // One per resource
+    QTimer *timer; // Sampling interval
+    Level current = Normal; // Level after hysteresis
+    int calmSamples = 0; // Consecutive samples below the current level
+    bool memoryHigh = false; // Memory stalls above their elevated threshold
+    bool available = false; // PSI files are readable
+};
+
+// Constructor implementation
+PressureMonitor::PressureMonitor(QObject *parent) : QObject(parent), timer(new QTimer(this)) {
+    const QList<Threshold> defaults = {{"cpu", 40, 80}, {"io", 30, 60}, {"memory", 10, 25}};
+    for (Threshold threshold : defaults) {
+        QStringList values = qEnvironmentVariable(QString("YTDLP_GUI_PSI_%1").arg(threshold.resource.toUpper()).toLatin1().constData())
+                                 .split(',', Qt::SkipEmptyParts);
+        if (values.size() >= 1) threshold.elevated = values.at(0).toDouble();
+        threshold.critical = values.size() >= 2 ? values.at(1).toDouble() : qMax(threshold.critical, threshold.elevated * 2);
+        thresholds << threshold;
+    }
+    available = stall("cpu") >= 0;
+    connect(timer, &QTimer::timeout, this, &PressureMonitor::sample);
+    if (available) timer->start(2000);
+}
+
+// stall: The "some avg10" value of a resource, -1 if unreadable.
+double PressureMonitor::stall(const QString &resource) {
+    QFile file("/proc/pressure/" + resource);
+    if (!file.open(QIODevice::ReadOnly)) return -1;
+    // First line: "some avg10=1.23 avg60=0.80 avg300=0.22 total=123456"
+    QByteArray line = file.readLine();
+    int start = line.indexOf("avg10=");
+    return start < 0 ? -1 : line.mid(start + 6).split(' ').first().toDouble();
+}
+
+// sample: Reads the pressure files and updates the level.
+void PressureMonitor::sample() {
+    Level raw = Normal;
+    QStringList reasons;
+    for (const Threshold &threshold : thresholds) {
+        double value = stall(threshold.resource);
+        Level level = value >= threshold.critical ? Critical : value >= threshold.elevated ? Elevated : Normal;
+        if (level != Normal) reasons << QString("%1 %2%").arg(threshold.resource).arg(value, 0, 'f', 0);
+        raw = qMax(raw, level);
+        if (threshold.resource == "memory" && (value >= threshold.elevated) != memoryHigh) {
+            memoryHigh = value >= threshold.elevated;
+            emit memoryPressureChanged(memoryHigh);
+        }
+    }
+    if (raw >= current) {
+        current = raw;
+        calmSamples = 0;
+    } else if (++calmSamples >= 3) {
+        current = Level(current - 1);
+        calmSamples = 0;
+    }
+    emit sampled(current, reasons.isEmpty() ? QString("no stalls") : "stalls: " + reasons.join(", "));
+}
+
+// WorkerPool: Keeps long-lived yt-dlp driver processes (ytdlp_worker.py) warm.
+// Jobs are sent to an idle worker as one JSON line and answered by a stream of
+// JSON events, so Python and yt-dlp are imported once per worker instead of once
+// per job. Workers are recycled after a number of jobs or when their memory grows.
+class WorkerPool : public QObject {
+    Q_OBJECT
+public:
+    // Constructor: Creates a pool of up to maxWorkers workers running at the given priority and prewarms one.
+    WorkerPool(int maxWorkers, const ProcessPriority &priority, QObject *parent = nullptr);
+    // Destructor: Asks the workers to exit.
+    ~WorkerPool() override;
+    // isAvailable: False once workers repeatedly failed to start (no python3 or yt_dlp module).
+    bool isAvailable() const { return available; }
+    // submit: Queues a request such as {"op": "probe", "urls": [...]} and returns its job id.
+    int submit(QJsonObject request);
+    // processIdFor: The pid of the worker serving a job, 0 while it is queued.
+    qint64 processIdFor(int jobId) const;
+    // cgroupFor: The cgroup of the worker serving a job, empty while queued or without cgroups.
+    QString cgroupFor(int jobId) const;
+    // control: Sends a message such as {"op": "limit"} to the worker serving a job; false if none is.
+    bool control(int jobId, QJsonObject message);
+
+signals:
+    // workerReady: Emitted when a freshly started worker has imported yt-dlp.
+    void workerReady();
+    // jobEvent: Emitted for every event a worker reports for a job.
+    void jobEvent(int jobId, const QJsonObject &event);
+    // jobFinished: Emitted once a job is done, successfully or not.
+    void jobFinished(int jobId, bool ok, const QString &error);
+    // jobRejected: Emitted for queued jobs when the pool became unavailable; run them another way.
+    void jobRejected(int jobId);
+
+private:
+    // Worker: One driver process and the job it is serving.
+    struct Worker {
+        QProcess *process = nullptr; // Driver process
+        QString cgroup; // The worker's own cgroup, empty without cgroups
+        bool ready = false; // Driver has imported yt-dlp
+        bool retiring = false; // Asked to exit, takes no more jobs
+        int jobId = -1; // Job being served, -1 when idle
+        int jobsServed = 0; // Jobs served since start
+        QByteArray buffer; // Incomplete protocol line
+        QByteArray stderrTail; // Last stderr output, for crash reports
+    };
+
+    // spawnWorker: Starts a new driver process.
+    void spawnWorker();
+    // dispatch: Hands queued jobs to idle workers, starting workers as needed.
+    void dispatch();
+    // readWorker: Splits a worker's protocol output into events.
+    void readWorker(Worker *worker);
+    // handleEvent: Processes one event from a worker.
+    void handleEvent(Worker *worker, const QJsonObject &event);
+    // workerExited: Cleans up after a worker process ended.
+    void workerExited(Worker *worker);
+    // retire: Lets a worker finish and exit; a fresh one replaces it on demand.
+    void retire(Worker *worker);
+
+    QList<Worker *> workers; // Running workers
+    QList<QJsonObject> queue; // Jobs waiting for an idle worker
+    QString script; // Driver source, passed to python with -c
+    ProcessPriority priority; // Scheduling class of every worker
+    int maxWorkers; // Upper bound on concurrent workers
+    int jobsPerWorker = 25; // Recycle a worker after this many jobs
+    qint64 memoryLimitKb = 1024 * 1024; // Recycle a worker above this resident size
+    int failedStarts = 0; // Consecutive workers that died before becoming ready
+    int nextJobId = 1; // Id of the next submitted job
+    bool available = true; // Pool is usable
+};
+
+// Constructor implementation
+WorkerPool::WorkerPool(int maxWorkers, const ProcessPriority &priority, QObject *parent)
+    : QObject(parent), priority(priority), maxWorkers(qMax(1, maxWorkers)) {
+    QFile file(":/ytdlp_worker.py");
+    if (file.open(QIODevice::ReadOnly)) script = QString::fromUtf8(file.readAll());
+    available = !script.isEmpty();
+    if (available) spawnWorker(); // Prewarm so the first job does not pay startup
+}
+
+// Destructor implementation
+WorkerPool::~WorkerPool() {
+    for (Worker *worker : workers) {
+        worker->process->disconnect(this);
+        worker->process->write("{\"op\": \"exit\"}\n");
+        worker->process->closeWriteChannel();
+        if (!worker->process->waitForFinished(1000)) {
+            worker->process->kill();
+            worker->process->waitForFinished(1000);
+        }
+        CgroupTree::shared().remove(worker->cgroup);
+        delete worker;
+    }
+}
+
+// submit: Queues a request such as {"op": "probe", "urls": [...]} and returns its job id.
+int WorkerPool::submit(QJsonObject request) {
+    int jobId = nextJobId++;
+    request["id"] = jobId;
+    queue.append(request);
+    if (available) {
+        dispatch();
+    } else {
+        QMetaObject::invokeMethod(this, [this] { dispatch(); }, Qt::QueuedConnection);
+    }
+    return jobId;
+}
+
+// processIdFor: The pid of the worker serving a job, 0 while it is queued.
+qint64 WorkerPool::processIdFor(int jobId) const {
+    for (Worker *worker : workers) {
+        if (worker->jobId == jobId) return worker->process->processId();
+    }
+    return 0;
+}
+
+// cgroupFor: The cgroup of the worker serving a job, empty while queued or without cgroups.
+QString WorkerPool::cgroupFor(int jobId) const {
+    for (Worker *worker : workers) {
+        if (worker->jobId == jobId) return worker->cgroup;
+    }
+    return QString();
+}
+
+// control: Sends a message such as {"op": "limit"} to the worker serving a job; false if none is.
+bool WorkerPool::control(int jobId, QJsonObject message) {
+    for (Worker *worker : workers) {
+        if (worker->jobId != jobId || !worker->ready) continue;
+        message["id"] = jobId;
+        worker->process->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+        return true;
+    }
+    return false;
+}
+
+// spawnWorker: Starts a new driver process.
+void WorkerPool::spawnWorker() {
+    static int nextWorker = 1; // Names worker cgroups uniquely across pools
+    auto *worker = new Worker;
+    auto *process = new ChildProcess(priority, this);
+    worker->cgroup = CgroupTree::shared().group(priority, QString("worker-%1").arg(nextWorker++));
+    process->setCgroup(worker->cgroup);
+    worker->process = process;
+    workers.append(worker);
+    connect(worker->process, &QProcess::readyReadStandardOutput, this, [this, worker] { readWorker(worker); });
+    connect(worker->process, &QProcess::readyReadStandardError, this, [worker] {
+        worker->stderrTail = (worker->stderrTail + worker->process->readAllStandardError()).right(2048);
+    });
+    connect(worker->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, worker] { workerExited(worker); });
+    connect(worker->process, &QProcess::errorOccurred, this, [this, worker](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) workerExited(worker);
+    });
+#ifdef Q_OS_WIN
+    QString python = qEnvironmentVariable("YTDLP_GUI_PYTHON", "python");
+#else
+    QString python = qEnvironmentVariable("YTDLP_GUI_PYTHON", "python3");
+#endif
+    worker->process->start(python, QStringList() << "-u" << "-c" << script);
+}
+
+// dispatch: Hands queued jobs to idle workers, starting workers as needed.
+void WorkerPool::dispatch() {
+    if (!available) {
+        // Give the jobs back so callers can spawn yt-dlp directly
+        QList<QJsonObject> rejected = queue;
+        queue.clear();
+        for (const QJsonObject &request : rejected) emit jobRejected(request["id"].toInt());
+        return;
+    }
+    int starting = 0;
+    for (Worker *worker : workers) {
+        if (queue.isEmpty()) return;
+        if (worker->retiring) continue;
+        if (!worker->ready) { ++starting; continue; }
+        if (worker->jobId >= 0) continue;
+        QJsonObject request = queue.takeFirst();
+        worker->jobId = request["id"].toInt();
+        worker->process->write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+    }
+    // Start more workers only for jobs no starting worker will pick up
+    int active = 0;
+    for (Worker *worker : workers) if (!worker->retiring) ++active;
+    for (int i = starting; i < queue.size() && active < maxWorkers; ++i, ++active) spawnWorker();
+}
+
+// readWorker: Splits a worker's protocol output into events.
+void WorkerPool::readWorker(Worker *worker) {
+    worker->buffer += worker->process->readAllStandardOutput();
+    int newline;
+    while ((newline = worker->buffer.indexOf('\n')) >= 0) {
+        QByteArray line = worker->buffer.left(newline);
+        worker->buffer.remove(0, newline + 1);
+        QJsonObject event = QJsonDocument::fromJson(line).object();
+        if (!event.isEmpty()) handleEvent(worker, event);
+    }
+}
+
+// handleEvent: Processes one event from a worker.
+void WorkerPool::handleEvent(Worker *worker, const QJsonObject &event) {
+    QString type = event["event"].toString();
+    if (type == "ready") {
+        worker->ready = true;
+        failedStarts = 0;
+        emit workerReady();
+        dispatch();
+        return;
+    }
+    int jobId = event["id"].toInt(-1);
+    if (jobId < 0 || jobId != worker->jobId) return;
+    if (type != "done") {
+        emit jobEvent(jobId, event);
+        return;
+    }
+    worker->jobId = -1;
+    ++worker->jobsServed;
+    if (worker->jobsServed >= jobsPerWorker || qint64(event["rss_kb"].toDouble()) > memoryLimitKb) retire(worker);
+    emit jobFinished(jobId, event["ok"].toBool(), event["error"].toString());
+    dispatch();
+}
+
+// workerExited: Cleans up after a worker process ended.
+void WorkerPool::workerExited(Worker *worker) {
+    if (!workers.removeOne(worker)) return; // Already handled (errorOccurred and finished both fire)
+    if (!worker->ready && !worker->retiring && ++failedStarts >= 2) available = false;
+    if (worker->jobId >= 0) {
+        QString error = QString("yt-dlp worker exited: %1").arg(QString::fromUtf8(worker->stderrTail).trimmed());
+        emit jobFinished(worker->jobId, false, error);
+    }
+    worker->process->deleteLater();
+    CgroupTree::shared().remove(worker->cgroup);
+    delete worker;
+    if (available && workers.isEmpty() && queue.isEmpty()) {
+        spawnWorker(); // Keep one warm worker around
+    } else {
+        dispatch();
+    }
+}
+
+// retire: Lets a worker finish and exit; a fresh one replaces it on demand.
+void WorkerPool::retire(Worker *worker) {
+    worker->retiring = true;
+    worker->process->write("{\"op\": \"exit\"}\n");
+    worker->process->closeWriteChannel();
+}
+
+// JsonPullParser: Incremental JSON tokenizer for documents streamed through a pipe.
+// Bytes are fed as they arrive and tokens are pulled one at a time; only an unfinished
+// token is kept between feeds, so memory does not grow with the document. Strings are
+// only decoded while decoding is on, which lets callers skip values they do not want.
+// Between top-level objects, anything else is returned line by line as Text (yt-dlp's
+// merged error output).
+class JsonPullParser {
+public:
+    // Token: What next() found.
+    enum Token { NeedMore, BeginObject, EndObject, BeginArray, EndArray, Key, String, Number, Bool, Null, Text, Error };
+
+    // feed: Appends bytes read from the pipe.
+    void feed(const QByteArray &bytes) {
+        // Drop consumed bytes before growing the buffer
+        if (pos >= buffer.size()) {
+            buffer.clear();
+            pos = 0;
+        } else if (pos >= 65536) {
+            buffer.remove(0, pos);
+            pos = 0;
+        }
+        buffer += bytes;
+    }
+    // finish: Marks the end of input, so a trailing number or text line completes.
+    void finish() { finished = true; }
+    // setDecoding: Turns string decoding on or off; text() is empty while it is off.
+    void setDecoding(bool on) { decoding = on; }
+    // next: Returns the next token, or NeedMore until more bytes are fed.
+    Token next();
+    // text: Value of the last Key, String or Text token.
+    const QString &text() const { return value; }
+    // number: Value of the last Number token.
+    double number() const { return numberValue; }
+    // boolean: Value of the last Bool token.
+    bool boolean() const { return boolValue; }
+
+private:
+    // scanString: Reads a string token starting at the opening quote.
+    Token scanString();
+    // scanNumber: Reads a number token.
+    Token scanNumber();
+    // scanLiteral: Reads true, false or null.
+    Token scanLiteral(const char *word, Token token, bool boolean);
+    // fail: Drops the broken document up to the end of its line.
+    Token fail();
+    // unescape: Decodes a JSON string body that contains escapes.
+    static QString unescape(const char *data, int size);
+
+    QByteArray buffer; // Unconsumed input
+    int pos = 0; // Read position in buffer
+    QByteArray stack; // Open containers, '{' or '['
+    bool keyNext = false; // The next string in the current object is a key
+    bool finished = false; // No more input will arrive
+    bool decoding = true; // Whether strings are decoded into value
+    QString value; // Last key, string or text line
+    double numberValue = 0; // Last number
+    bool boolValue = false; // Last boolean
+};
+
+// next: Returns the next token, or NeedMore until more bytes are fed.
+JsonPullParser::Token JsonPullParser::next() {
+    while (pos < buffer.size()) {
+        char c = buffer.at(pos);
+        if (stack.isEmpty()) {
+            if (c == '{') {
+                ++pos;
+                stack.append('{');
+                keyNext = true;
+                return BeginObject;
+            }
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                ++pos;
+                continue;
+            }
+            int newline = buffer.indexOf('\n', pos);
+            if (newline < 0 && !finished) return NeedMore;
+            int end = newline < 0 ? buffer.size() : newline;
+            value = QString::fromUtf8(buffer.constData() + pos, end - pos).trimmed();
+            pos = newline < 0 ? buffer.size() : newline + 1;
+            return Text;
+        }
+        switch (c) {
+        case ' ': case '\t': case '\r': case '\n': case ':':
+            ++pos;
+            continue;
+        case ',':
+            ++pos;
+            keyNext = stack.endsWith('{');
+            continue;
+        case '{':
+        case '[':
+            ++pos;
+            stack.append(c);
+            keyNext = c == '{';
+            return c == '{' ? BeginObject : BeginArray;
+        case '}':
+        case ']':
+            if (stack.at(stack.size() - 1) != (c == '}' ? '{' : '[')) return fail();
+            ++pos;
+            stack.chop(1);
+            keyNext = false;
+            return c == '}' ? EndObject : EndArray;
+        case '"':
+            return scanString();
+        case 't':
+            return scanLiteral("true", Bool, true);
+        case 'f':
+            return scanLiteral("false", Bool, false);
+        case 'n':
+            return scanLiteral("null", Null, false);
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) return scanNumber();
+            return fail();
+        }
+    }
+    if (finished && !stack.isEmpty()) return fail(); // Truncated document
+    return NeedMore;
+}
+
+// scanString: Reads a string token starting at the opening quote.
+JsonPullParser::Token JsonPullParser::scanString() {
+    const char *data = buffer.constData();
+    int size = buffer.size(), start = pos + 1, end = start;
+    bool escaped = false;
+    while (end < size && data[end] != '"') {
+        if (data[end] == '\\') {
+            escaped = true;
+            ++end;
+        }
+        ++end;
+    }
+    if (end >= size) return finished ? fail() : NeedMore;
+    bool key = keyNext;
+    keyNext = false;
+    if (!decoding) value.clear();
+    else value = escaped ? unescape(data + start, end - start) : QString::fromUtf8(data + start, end - start);
+    pos = end + 1;
+    return key ? Key : String;
+}
+
+// scanNumber: Reads a number token.
+JsonPullParser::Token JsonPullParser::scanNumber() {
+    const char *data = buffer.constData();
+    int size = buffer.size(), end = pos;
+    auto isNumberChar = [](char c) { return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; };
+    while (end < size && isNumberChar(data[end])) ++end;
+    if (end >= size && !finished) return NeedMore; // The number may continue in the next read
+    numberValue = QByteArray::fromRawData(data + pos, end - pos).toDouble();
+    pos = end;
+    keyNext = false;
+    return Number;
+}
+
+// scanLiteral: Reads true, false or null.
+JsonPullParser::Token JsonPullParser::scanLiteral(const char *word, Token token, bool boolean) {
+    int length = int(qstrlen(word));
+    if (buffer.size() - pos < length) return finished ? fail() : NeedMore;
+    if (qstrncmp(buffer.constData() + pos, word, uint(length)) != 0) return fail();
+    pos += length;
+    keyNext = false;
+    boolValue = boolean;
+    return token;
+}
+
+// fail: Drops the broken document up to the end of its line.
+JsonPullParser::Token JsonPullParser::fail() {
+    stack.clear();
+    keyNext = false;
+    int newline = buffer.indexOf('\n', pos);
+    pos = newline < 0 ? buffer.size() : newline + 1;
+    return Error;
+}
+
+// unescape: Decodes a JSON string body that contains escapes.
+QString JsonPullParser::unescape(const char *data, int size) {
+    QString out;
+    int run = 0; // Start of the current unescaped run
+    for (int i = 0; i < size; ++i) {
+        if (data[i] != '\\' || i + 1 >= size) continue;
+        out += QString::fromUtf8(data + run, i - run);
+        char escape = data[++i];
+        switch (escape) {
+        case 'b': out += QLatin1Char('\b'); break;
+        case 'f': out += QLatin1Char('\f'); break;
+        case 'n': out += QLatin1Char('\n'); break;
+        case 'r': out += QLatin1Char('\r'); break;
+        case 't': out += QLatin1Char('\t'); break;
+        case 'u':
+            // Surrogate pairs arrive as two escapes and form a valid UTF-16 pair in QString
+            if (i + 4 < size) {
+                out += QChar(ushort(QByteArray(data + i + 1, 4).toUShort(nullptr, 16)));
+                i += 4;
+            }
+            break;
+        default: out += QLatin1Char(escape); break; // \" \\ \/
+        }
+        run = i + 1;
+    }
+    out += QString::fromUtf8(data + run, size - run);
+    return out;
+}
+
+// ProbeReader: Reduces streamed "yt-dlp -J" output to the fields the app uses.
+// A probe of a large channel is tens of MB of JSON, mostly formats' fragment lists,
+// HTTP headers and thumbnail details. Only selected fields are materialized (the playlist
+// entries, a summary of each format, subtitle languages and chapters); everything
+// else is skipped token by token without being decoded or copied.
+class ProbeReader {
+public:
+    // Result: What read() produced.
+    enum Result { NeedMore, Document, Line };
+
+    // feed: Appends bytes read from yt-dlp's output.
+    void feed(const QByteArray &bytes) { parser.feed(bytes); }
+    // finish: Marks the end of yt-dlp's output.
+    void finish() { parser.finish(); }
+    // read: Consumes input until a document or text line is complete.
+    Result read();
+    // document: The reduced metadata of the last Document result.
+    const QJsonObject &document() const { return result; }
+    // line: The text of the last Line result.
+    const QString &line() const { return parser.text(); }
+
+private:
+    // Selector: One level of the field selection; "*" matches any key and "[]" array elements.
+    struct Selector {
+        QHash<QString, Selector *> children; // Selected keys below this level
+        bool leaf = false; // Keep the whole value here
+
+        // child: The selection for a key, nullptr when it is skipped.
+        const Selector *child(const QString &key) const {
+            Selector *next = children.value(key);
+            return next ? next : children.value(QStringLiteral("*"));
+        }
+    };
+    // Frame: A container being collected.
+    struct Frame {
+        bool isArray = false; // Array or object
+        bool keepAll = false; // Every descendant is kept
+        const Selector *selector = nullptr; // Selection inside this container
+        QString key; // Key of the value being read (objects)
+        QJsonObject object; // Collected members
+        QJsonArray array; // Collected elements
+    };
+
+    // selection: The fields kept from probe output, built once.
+    static const Selector *selection();
+    // attach: Adds a finished value to the container being collected.
+    void attach(const QJsonValue &value);
+
+    JsonPullParser parser; // Tokenizer
+    QList<Frame> frames; // Containers being collected, innermost last
+    int skipDepth = 0; // Nesting inside a skipped container
+    bool skipNext = false; // The value after the last key is skipped
+    bool keepNext = false; // The value after the last key is kept whole
+    const Selector *nextSelector = nullptr; // Selection of the value after the last key
+    QJsonObject result; // Last completed document
+};
+
+// selection: The fields kept from probe output, built once.
+const ProbeReader::Selector *ProbeReader::selection() {
+    static Selector *root = [] {
+        static const char *const fields[] = {
+            "id", "title", "duration", "uploader", "channel", "thumbnail", "_type", "original_url", "webpage_url",
+            "url", "filesize", "filesize_approx", "playlist_count",
+            "formats.[].format_id", "formats.[].ext", "formats.[].vcodec", "formats.[].acodec", "formats.[].height",
+            "formats.[].fps", "formats.[].tbr", "formats.[].abr", "formats.[].filesize", "formats.[].filesize_approx",
+            "entries.[].id", "entries.[].title", "entries.[].duration", "entries.[].url", "entries.[].webpage_url",
+            "entries.[].uploader", "entries.[].channel", "entries.[].thumbnail", "entries.[].thumbnails.[].url",
+            "entries.[].thumbnails.[].width", "thumbnails.[].url", "thumbnails.[].width",
+            "subtitles.*.[].name", "automatic_captions.*.[].name",
+            "chapters.[].start_time", "chapters.[].end_time", "chapters.[].title",
+        };
+        auto *top = new Selector;
+        for (const char *field : fields) {
+            Selector *node = top;
+            for (const QString &part : QString(field).split('.')) {
+                if (!node->children.contains(part)) node->children.insert(part, new Selector);
+                node = node->children.value(part);
+            }
+            node->leaf = true;
+        }
+        return top;
+    }();
+    return root;
+}
+
+// read: Consumes input until a document or text line is complete.
+ProbeReader::Result ProbeReader::read() {
+    while (true) {
+        JsonPullParser::Token token = parser.next();
+        if (token == JsonPullParser::NeedMore) return NeedMore;
+        if (token == JsonPullParser::Text) return Line;
+        if (token == JsonPullParser::Error) {
+            // The rest of the broken document was dropped; start over with the next one
+            frames.clear();
+            skipDepth = 0;
+            skipNext = false;
+            parser.setDecoding(true);
+            continue;
+        }
+        bool begin = token == JsonPullParser::BeginObject || token == JsonPullParser::BeginArray;
+        bool end = token == JsonPullParser::EndObject || token == JsonPullParser::EndArray;
+        if (skipDepth > 0) {
+            if (begin) ++skipDepth;
+            if (end && --skipDepth == 0) parser.setDecoding(true);
+            continue;
+        }
+        if (token == JsonPullParser::Key) {
+            Frame &frame = frames.last();
+            frame.key = parser.text();
+            keepNext = frame.keepAll;
+            nextSelector = keepNext ? nullptr : frame.selector->child(frame.key);
+            keepNext = keepNext || (nextSelector && nextSelector->leaf);
+            skipNext = !keepNext && !nextSelector;
+            if (skipNext) parser.setDecoding(false);
+            continue;
+        }
+        if (end) {
+            Frame frame = frames.takeLast();
+            if (frames.isEmpty()) {
+                result = frame.object;
+                return Document;
+            }
+            attach(frame.isArray ? QJsonValue(frame.array) : QJsonValue(frame.object));
+            continue;
+        }
+        // A value: its selection comes from the key before it or from the enclosing array
+        bool keep = true, skip = false;
+        const Selector *selector = selection();
+        if (!frames.isEmpty()) {
+            const Frame &parent = frames.last();
+            if (parent.isArray) {
+                keep = parent.keepAll;
+                selector = keep ? nullptr : parent.selector->child(QStringLiteral("[]"));
+                keep = keep || (selector && selector->leaf);
+                skip = !keep && !selector;
+            } else {
+                keep = keepNext;
+                selector = nextSelector;
+                skip = skipNext;
+                skipNext = false;
+            }
+        } else {
+            keep = false;
+        }
+        if (skip) {
+            if (begin) {
+                skipDepth = 1;
+                parser.setDecoding(false);
+            } else {
+                parser.setDecoding(true);
+            }
+            continue;
+        }
+        if (begin) {
+            Frame frame;
+            frame.isArray = token == JsonPullParser::BeginArray;
+            frame.keepAll = keep;
+            frame.selector = selector;
+            frames.append(frame);
+            continue;
+        }
+        switch (token) {
+        case JsonPullParser::String: attach(parser.text()); break;
+        case JsonPullParser::Number: attach(parser.number()); break;
+        case JsonPullParser::Bool: attach(parser.boolean()); break;
+        default: attach(QJsonValue::Null); break;
+        }
+    }
+}
+
+// attach: Adds a finished value to the container being collected.
+void ProbeReader::attach(const QJsonValue &value) {
+    if (frames.isEmpty()) return; // A bare scalar at the top level is not metadata
+    Frame &frame = frames.last();
+    if (frame.isArray) frame.array.append(value);
+    else frame.object.insert(frame.key, value);
+}
+
+// MetadataProber: Probes URLs for metadata using batched yt-dlp runs.
+// Queued URLs are handed to a warm worker, or to one "yt-dlp -J --batch-file -"
+// process when no worker is available, so the Python interpreter and yt-dlp import
+// cost is paid once per batch at most instead of once per URL.
+class MetadataProber : public QObject {
+    Q_OBJECT
+public:
+    // Constructor: Creates an idle prober.
+    explicit MetadataProber(QObject *parent = nullptr);
+    // probe: Queues URLs for probing; each one is answered by probed() or probeFailed().
+    // URLs probed recently are answered from the cache without running yt-dlp.
+    void probe(const QStringList &urls);
+    // cancel: Drops a probe nobody needs anymore; running batches of only cancelled URLs are stopped.
+    void cancel(const QString &url);
+    // setWorkerPool: Routes batches through warm workers while the pool is available.
+    void setWorkerPool(WorkerPool *workerPool);
+    // setCacheLimit: Changes how many URLs the cache keeps, evicting the oldest at once.
+    void setCacheLimit(int entries);
+
+signals:
+    // probed: Emitted with the parsed metadata once a URL has been probed.
+    void probed(const QString &url, const QJsonObject &metadata);
+    // probeFailed: Emitted when yt-dlp could not probe a URL.
+    void probeFailed(const QString &url, const QString &error);
+
+private slots:
+    // readBatchOutput: Splits streamed yt-dlp output into lines and demultiplexes them.
+    void readBatchOutput();
+    // batchFinished: Settles URLs the batch left unanswered and sizes the next batch.
+    void batchFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    // batchError: Fails every queued URL when yt-dlp cannot be started at all.
+    void batchError(QProcess::ProcessError error);
+    // workerEvent: Demultiplexes per-URL results reported by a warm worker.
+    void workerEvent(int jobId, const QJsonObject &event);
+    // workerFinished: Settles URLs the worker left unanswered and sizes the next batch.
+    void workerFinished(int jobId, bool ok, const QString &error);
+    // workerRejected: Requeues a batch the pool could not run so it is spawned directly.
+    void workerRejected(int jobId);
+
+private:
+    // startNextBatch: Launches yt-dlp for the next slice of queued URLs.
+    void startNextBatch();
+    // handleDocument: Routes one probed document to the URL it belongs to.
+    void handleDocument(const QJsonObject &json);
+    // indexOfId: The one in-flight URL containing a video id as a whole URL component, -1 if none or several.
+    int indexOfId(const QString &id) const;
+    // handleLine: Attributes a line of error output to the URL it names.
+    void handleLine(const QString &line);
+    // drainReader: Handles every document and line the reader has completed.
+    void drainReader();
+    // resolveAt: Removes an answered URL from the running batch.
+    void resolveAt(int index);
+    // adaptBatchSize: Picks the next batch size from the measured startup and per-URL latency.
+    void adaptBatchSize(qint64 elapsedMs);
+    // remember: Caches metadata, evicting the oldest entries beyond the cache limit.
+    void remember(const QString &url, const QJsonObject &metadata);
+    // takeUnanswered: Empties the running batch and returns its unanswered, uncancelled URLs.
+    QStringList takeUnanswered();
+
+    // CacheEntry: Probed metadata and when it was fetched.
+    struct CacheEntry {
+        QJsonObject metadata; // Probe result
+        qint64 fetchedAt = 0; // Milliseconds since the epoch
+    };
+
+    QStringList queue; // URLs waiting for a batch
+    QStringList inFlight; // Unanswered URLs of the running batch, in submission order
+    QProcess *process = nullptr; // Running yt-dlp batch process
+    WorkerPool *pool = nullptr; // Warm workers, preferred over spawning yt-dlp
+    int poolJob = -1; // Worker job running the current batch, -1 if none
+    ProbeReader reader; // Streaming parser of the batch's output
+    QString lastError; // Most recent unattributed error text of the batch
+    bool unattributed = false; // The batch produced a document or error no URL of it could be matched to
+    int batchUrls = 0; // URLs the running batch started with
+    QElapsedTimer batchTimer; // Wall time of the running batch
+    qint64 firstResultMs = -1; // Time until the batch produced its first answer
+    int answeredInBatch = 0; // URLs answered by the running batch
+    int batchSize = 4; // URLs per batch, adapted to measured latency
+    QSet<QString> cancelled; // In-flight URLs whose result nobody waits for
+    QHash<QString, CacheEntry> cache; // Recent probe results by URL
+    QStringList cacheOrder; // Cached URLs, oldest first
+    int cacheLimit = 200; // Most URLs kept in the cache
+    qint64 cacheLifetimeMs = 30 * 60 * 1000; // Age after which a cached probe is redone
+};
+
+// Constructor implementation
+MetadataProber::MetadataProber(QObject *parent) : QObject(parent) {}
+
+// probe: Queues URLs for probing; each one is answered by probed() or probeFailed().
+void MetadataProber::probe(const QStringList &urls) {
+    QList<QPair<QString, QJsonObject>> hits;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (const QString &url : urls) {
+        cancelled.remove(url);
+        auto cached = cache.constFind(url);
+        if (cached != cache.constEnd() && now - cached->fetchedAt < cacheLifetimeMs) {
+            hits.append(qMakePair(url, cached->metadata));
+        } else if (!queue.contains(url) && !inFlight.contains(url)) {
+            queue.append(url);
+        }
+    }
+    // Answer cache hits asynchronously, like real probes
+    if (!hits.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this, hits] {
+            for (const auto &hit : hits) emit probed(hit.first, hit.second);
+        }, Qt::QueuedConnection);
+    }
+    if (!process && poolJob < 0) startNextBatch();
+}
+
+// cancel: Drops a probe nobody needs anymore; running batches of only cancelled URLs are stopped.
+void MetadataProber::cancel(const QString &url) {
+    queue.removeAll(url);
+    if (!inFlight.contains(url)) return;
+    cancelled.insert(url);
+    // A warm worker cannot be interrupted cheaply; its answer still lands in the cache
+    if (!process) return;
+    for (const QString &pending : inFlight) {
+        if (!cancelled.contains(pending)) return;
+    }
+    process->kill();
+}
+
+// remember: Caches metadata, evicting the oldest entries beyond the cache limit.
+void MetadataProber::remember(const QString &url, const QJsonObject &metadata) {
+    if (cache.contains(url)) cacheOrder.removeOne(url);
+    CacheEntry entry;
+    entry.metadata = metadata;
+    entry.fetchedAt = QDateTime::currentMSecsSinceEpoch();
+    cache.insert(url, entry);
+    cacheOrder.append(url);
+    while (cacheOrder.size() > cacheLimit) cache.remove(cacheOrder.takeFirst());
+}
+
+// setCacheLimit: Changes how many URLs the cache keeps, evicting the oldest at once.
+void MetadataProber::setCacheLimit(int entries) {
+    cacheLimit = qMax(0, entries);
+    while (cacheOrder.size() > cacheLimit) cache.remove(cacheOrder.takeFirst());
+}
+
+// takeUnanswered: Empties the running batch and returns its unanswered, uncancelled URLs.
+QStringList MetadataProber::takeUnanswered() {
+    QStringList unanswered;
+    for (const QString &url : inFlight) {
+        if (!cancelled.contains(url)) unanswered << url;
+    }
+    inFlight.clear();
+    cancelled.clear();
+    return unanswered;
+}
+
+// setWorkerPool: Routes batches through warm workers while the pool is available.
+void MetadataProber::setWorkerPool(WorkerPool *workerPool) {
+    pool = workerPool;
+    connect(pool, &WorkerPool::jobEvent, this, &MetadataProber::workerEvent);
+    connect(pool, &WorkerPool::jobFinished, this, &MetadataProber::workerFinished);
+    connect(pool, &WorkerPool::jobRejected, this, &MetadataProber::workerRejected);
+}
+
+// startNextBatch: Launches yt-dlp for the next slice of queued URLs.
+void MetadataProber::startNextBatch() {
+    if (queue.isEmpty()) return;
+    inFlight = queue.mid(0, batchSize);
+    queue = queue.mid(inFlight.size());
+    reader = ProbeReader();
+    lastError.clear();
+    unattributed = false;
+    batchUrls = inFlight.size();
+    firstResultMs = -1;
+    answeredInBatch = 0;
+    batchTimer.start();
+
+    if (pool && pool->isAvailable()) {
+        QJsonObject request;
+        request["op"] = "probe";
+        request["urls"] = QJsonArray::fromStringList(inFlight);
+        poolJob = pool->submit(request);
+        return;
+    }
+
+    // -J prints one single-line JSON document per URL; --ignore-errors keeps one
+    // bad URL from aborting the rest of the batch. Both channels are merged so
+    // results and errors arrive in the order yt-dlp produced them.
+    // Someone is waiting for the answer, so probes always run at interactive priority
+    process = new ChildProcess(ProcessPriority::named("interactive"), this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    connect(process, &QProcess::errorOccurred, this, &MetadataProber::batchError);
+    connect(process, &QProcess::readyReadStandardOutput, this, &MetadataProber::readBatchOutput);
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &MetadataProber::batchFinished);
+    process->start("yt-dlp", QStringList() << "-J" << "--flat-playlist" << "--ignore-errors"
+                                           << "--no-warnings" << "--batch-file" << "-");
+    process->write(inFlight.join('\n').toUtf8() + '\n');
+    process->closeWriteChannel();
+}
+
+// readBatchOutput: Feeds streamed yt-dlp output to the reader and demultiplexes the results.
+// Documents are parsed as they arrive, so a huge playlist dump is never held in full.
+void MetadataProber::readBatchOutput() {
+    reader.feed(process->readAllStandardOutput());
+    drainReader();
+}
+
+// drainReader: Handles every document and line the reader has completed.
+void MetadataProber::drainReader() {
+    ProbeReader::Result result;
+    while ((result = reader.read()) != ProbeReader::NeedMore) {
+        if (result == ProbeReader::Document) handleDocument(reader.document());
+        else if (!reader.line().isEmpty()) handleLine(reader.line());
+    }
+}
+
+// handleDocument: Routes one probed document to the URL it belongs to.
+void MetadataProber::handleDocument(const QJsonObject &json) {
+    if (inFlight.isEmpty() || json.isEmpty()) return;
+    // Match on the URL yt-dlp was given; a batch of one can only be answering that URL.
+    // Anything else is not guessed at: its URLs stay pending and are retried one by one
+    int index = inFlight.indexOf(json["original_url"].toString());
+    if (index < 0) index = inFlight.indexOf(json["webpage_url"].toString());
+    if (index < 0 && batchUrls == 1) index = 0;
+    if (index < 0) {
+        unattributed = true;
+        lastError = "yt-dlp returned metadata for an unrequested URL " + json["original_url"].toString(json["webpage_url"].toString());
+        return;
+    }
+    QString url = inFlight.at(index);
+    resolveAt(index);
+    remember(url, json);
+    emit probed(url, json);
+}
+
+// handleLine: Attributes a line of error output to the URL it names.
+void MetadataProber::handleLine(const QString &line) {
+    if (inFlight.isEmpty()) return;
+    if (line.startsWith("ERROR:")) {
+        // Errors look like "ERROR: [extractor] id: message"; attribute by id when possible
+        QString message = line.mid(6).trimmed();
+        static const QRegularExpression idRe("^\\[[^\\]]+\\] ([^:\\s]+):");
+        QRegularExpressionMatch match = idRe.match(message);
+        int index = batchUrls == 1 ? 0 : match.hasMatch() ? indexOfId(match.captured(1)) : -1;
+        if (index < 0) {
+            unattributed = true;
+            lastError = message;
+            return;
+        }
+        QString url = inFlight.at(index);
+        resolveAt(index);
+        emit probeFailed(url, message);
+    } else {
+        lastError = line;
+    }
+}
+
+// indexOfId: The one in-flight URL containing a video id as a whole URL component, -1 if none or several.
+int MetadataProber::indexOfId(const QString &id) const {
+    static const QRegularExpression separators("[^A-Za-z0-9_-]+");
+    int index = -1;
+    for (int i = 0; i < inFlight.size(); ++i) {
+        if (!inFlight.at(i).split(separators, Qt::SkipEmptyParts).contains(id)) continue;
+        if (index >= 0) return -1; // Ambiguous
+        index = i;
+    }
+    return index;
+}
+
+// resolveAt: Removes an answered URL from the running batch.
+void MetadataProber::resolveAt(int index) {
+    cancelled.remove(inFlight.takeAt(index));
+    if (firstResultMs < 0) firstResultMs = batchTimer.elapsed();
+    ++answeredInBatch;
+}
+
+// batchFinished: Settles URLs the batch left unanswered and sizes the next batch.
+void MetadataProber::batchFinished(int exitCode, QProcess::ExitStatus exitStatus) {
+    Q_UNUSED(exitCode); // Non-zero whenever any URL failed, which is reported per URL
+    readBatchOutput();
+    reader.finish();
+    drainReader();
+    reader = ProbeReader();
+    qint64 elapsedMs = batchTimer.elapsed();
+    bool stopped = exitStatus == QProcess::CrashExit && !cancelled.isEmpty();
+    QStringList unanswered = takeUnanswered();
+    process->deleteLater();
+    process = nullptr;
+
+    if (stopped && unanswered.isEmpty()) {
+        // Killed because every URL in it was cancelled; nothing to report
+    } else if (exitStatus == QProcess::CrashExit && unanswered.size() > 1) {
+        // The whole batch died: retry the leftovers in smaller batches
+        batchSize = qMax(1, batchSize / 2);
+        queue = unanswered + queue;
+    } else if (unattributed && !unanswered.isEmpty()) {
+        // An answer could not be matched to its URL: probe the leftovers one at a time,
+        // where every answer is unambiguous
+        batchSize = 1;
+        queue = unanswered + queue;
+    } else {
+        QString error = lastError.isEmpty() ? QString("yt-dlp returned no metadata") : lastError;
+        for (const QString &url : unanswered) emit probeFailed(url, error);
+        adaptBatchSize(elapsedMs);
+    }
+    startNextBatch();
+}
+
+// batchError: Fails every queued URL when yt-dlp cannot be started at all.
+void MetadataProber::batchError(QProcess::ProcessError error) {
+    if (error != QProcess::FailedToStart) return; // Other errors end in batchFinished()
+    QString message = "Failed to start yt-dlp: " + process->errorString();
+    QStringList failed = takeUnanswered() + queue;
+    queue.clear();
+    process->deleteLater();
+    process = nullptr;
+    for (const QString &url : failed) emit probeFailed(url, message);
+}
+
+// workerEvent: Demultiplexes per-URL results reported by a warm worker.
+void MetadataProber::workerEvent(int jobId, const QJsonObject &event) {
+    if (jobId != poolJob) return;
+    QString url = event["url"].toString();
+    int index = inFlight.indexOf(url);
+    if (index < 0) return;
+    if (event["event"].toString() == "info") {
+        QJsonObject metadata = event["info"].toObject();
+        resolveAt(index);
+        remember(url, metadata);
+        emit probed(url, metadata);
+    } else if (event["event"].toString() == "error") {
+        resolveAt(index);
+        emit probeFailed(url, event["message"].toString());
+    }
+}
+
+// workerFinished: Settles URLs the worker left unanswered and sizes the next batch.
+void MetadataProber::workerFinished(int jobId, bool ok, const QString &error) {
+    if (jobId != poolJob) return;
+    poolJob = -1;
+    QStringList unanswered = takeUnanswered();
+    QString message = ok || error.isEmpty() ? QString("yt-dlp returned no metadata") : error;
+    for (const QString &url : unanswered) emit probeFailed(url, message);
+    adaptBatchSize(batchTimer.elapsed());
+    startNextBatch();
+}
+
+// workerRejected: Requeues a batch the pool could not run so it is spawned directly.
+void MetadataProber::workerRejected(int jobId) {
+    if (jobId != poolJob) return;
+    poolJob = -1;
+    queue = takeUnanswered() + queue;
+    startNextBatch();
+}
+
+// adaptBatchSize: Picks the next batch size from the measured startup and per-URL latency.
+void MetadataProber::adaptBatchSize(qint64 elapsedMs) {
+    if (answeredInBatch < 2 || firstResultMs < 0) {
+        // Not enough samples to separate startup from per-URL cost; grow gently
+        if (answeredInBatch > 0) batchSize = qMin(64, batchSize + 1);
+        return;
+    }
+    double perUrlMs = double(elapsedMs - firstResultMs) / (answeredInBatch - 1);
+    perUrlMs = qMax(perUrlMs, 1.0);
+    double startupMs = qMax(0.0, firstResultMs - perUrlMs);
+    // Keep startup under ~10% of a batch, but let no batch run much past 30 seconds
+    // so results keep streaming back at a steady pace.
+    int amortized = int(9.0 * startupMs / perUrlMs) + 1;
+    int bounded = int(30000.0 / perUrlMs);
+    int target = qBound(1, qMin(amortized, bounded), 64);
+    batchSize = qBound(1, (batchSize + target + 1) / 2, 64);
+}
+
+// SponsorStore: Local SponsorBlock segments, so cutting needs no API round trip per video and
+// works offline. "--import-sponsorblock" turns SponsorBlock's public sponsorTimes.csv dump (a
+// file, or a URL such as a mirror or a local stand-in server) into a store file: a hash table of
+// video ids followed by each video's segments. The file is memory-mapped, so opening it is free
+// and a lookup reads one slot chain and one record. Segments of recently processed ids, including
+// ones the API answered, are also kept in a small LRU.
+class SponsorStore {
+public:
+    // Segments: Start and end of each segment to remove, in seconds.
+    using Segments = QList<QPair<double, double>>;
+
+    // Constructor: Uses the store file at path once it exists.
+    explicit SponsorStore(const QString &path = defaultPath());
+    // Destructor: Unmaps the store file.
+    ~SponsorStore();
+    // defaultPath: YTDLP_GUI_SPONSORBLOCK_DB, or sponsorblock.db in the app data folder.
+    static QString defaultPath();
+    // categories: Segment categories removed, as with "yt-dlp --sponsorblock-remove all".
+    static const QStringList &categories();
+    // find: Looks up a video's segments; false when neither the store nor recent lookups know it.
+    bool find(const QString &videoId, Segments *segments);
+    // remember: Keeps segments found elsewhere (the API) with the recent lookups.
+    void remember(const QString &videoId, const Segments &segments) { recent.insert(videoId, new Segments(segments)); }
+    // import: Builds a store file from a sponsorTimes.csv dump; summary gets the counts or the error.
+    static bool import(QIODevice *csv, const QString &path, QString *summary);
+
+private:
+    // open: Maps the store file if it is new or was replaced since it was mapped.
+    void open();
+    // close: Unmaps the store file.
+    void close();
+    // hash: FNV-1a hash of a video id, for the slot table.
+    static quint64 hash(const QByteArray &id);
+    // readRecord: Reads one CSV record, which may span lines inside quotes.
+    static bool readRecord(QIODevice *csv, QList<QByteArray> *fields);
+
+    // Layout: "YTSB", version, slot count, video count, segment count, then the slots (file
+    // offsets of records, 0 when free) and the records: id length, id, segment count and
+    // start/end pairs as floats.
+    static const int HeaderSize = 32;
+
+    QFile file; // Store file
+    QDateTime mappedTime; // Modification time of the mapped file
+    const uchar *data = nullptr; // Mapped file, nullptr without a store
+    qint64 size = 0; // Bytes mapped
+    quint64 slotCount = 0; // Slots in the hash table, a power of two
+    QCache<QString, Segments> recent; // Segments of recently looked up ids
+};
+
+// Constructor implementation
+SponsorStore::SponsorStore(const QString &path) : file(path), recent(1000) {}
+
+// Destructor: Unmaps the store file.
+SponsorStore::~SponsorStore() {
+    close();
+}
+
+// defaultPath: YTDLP_GUI_SPONSORBLOCK_DB, or sponsorblock.db in the app data folder.
+QString SponsorStore::defaultPath() {
+    QString path = qEnvironmentVariable("YTDLP_GUI_SPONSORBLOCK_DB");
+    if (!path.isEmpty()) return path;
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/sponsorblock.db";
+}
+
+// categories: Segment categories removed, as with "yt-dlp --sponsorblock-remove all".
+const QStringList &SponsorStore::categories() {
+    static const QStringList names = {"sponsor", "intro", "outro", "selfpromo", "preview",
+                                      "filler", "interaction", "music_offtopic"};
+    return names;
+}
+
+// find: Looks up a video's segments; false when neither the store nor recent lookups know it.
+bool SponsorStore::find(const QString &videoId, Segments *segments) {
+    if (const Segments *hit = recent.object(videoId)) {
+        *segments = *hit;
+        return true;
+    }
+    open();
+    if (!data) return false;
+    QByteArray id = videoId.toUtf8();
+    quint64 mask = slotCount - 1;
+    // open() only checks the header and the slot table: every record read is bounded here, so a
+    // truncated or corrupted file reads nothing outside the map (and sums cannot overflow)
+    const quint64 records = HeaderSize + slotCount * 8, end = quint64(size);
+    for (quint64 slot = hash(id) & mask, probes = 0; probes < slotCount; slot = (slot + 1) & mask, ++probes) {
+        quint64 offset;
+        memcpy(&offset, data + HeaderSize + slot * 8, sizeof offset);
+        if (offset == 0) return false; // Free slot: not in the dump
+        if (offset < records || offset > end || end - offset < 3) return false; // Corrupted slot
+        int length = data[offset];
+        if (end - offset - 3 < quint64(length)) return false; // Truncated record
+        if (length != id.size() || memcmp(data + offset + 1, id.constData(), length) != 0) continue;
+        quint16 count;
+        memcpy(&count, data + offset + 1 + length, sizeof count);
+        const uchar *pairs = data + offset + 3 + length;
+        if (end - offset - 3 - length < quint64(count) * 8) return false; // Truncated segments
+        Segments found;
+        for (int i = 0; i < count; ++i) {
+            float segmentStart, segmentEnd; // Not "end": that is the bound of the map above
+            memcpy(&segmentStart, pairs + i * 8, 4);
+            memcpy(&segmentEnd, pairs + i * 8 + 4, 4);
+            found << qMakePair(double(segmentStart), double(segmentEnd));
+        }
+        remember(videoId, found);
+        *segments = found;
+        return true;
+    }
+    return false;
+}
+
+// open: Maps the store file if it is new or was replaced since it was mapped.
+void SponsorStore::open() {
+    QFileInfo info(file.fileName());
+    if (!info.exists()) {
+        close();
+        return;
+    }
+    if (data && info.lastModified() == mappedTime) return;
+    close();
+    if (!file.open(QIODevice::ReadOnly) || file.size() < HeaderSize) {
+        file.close();
+        return;
+    }
+    const uchar *map = file.map(0, file.size());
+    quint64 count = 0;
+    if (map) memcpy(&count, map + 8, sizeof count);
+    // The slot count has to be a power of two and the slots have to fit in the file
+    if (!map || memcmp(map, "YTSB", 4) != 0 || count == 0 || (count & (count - 1)) != 0
+        || count > quint64(file.size() - HeaderSize) / 8) {
+        if (map) file.unmap(const_cast<uchar *>(map));
+        file.close();
+        return;
+    }
+    data = map;
+    size = file.size();
+    slotCount = count;
+    mappedTime = info.lastModified();
+    recent.clear(); // A new import takes precedence over what was looked up before
+}
+
+// close: Unmaps the store file.
+void SponsorStore::close() {
+    if (data) file.unmap(const_cast<uchar *>(data));
+    data = nullptr;
+    size = 0;
+    slotCount = 0;
+    file.close();
+}
+
+// hash: FNV-1a hash of a video id, for the slot table.
+quint64 SponsorStore::hash(const QByteArray &id) {
+    quint64 value = 14695981039346656037ULL;
+    for (char c : id) value = (value ^ quint8(c)) * 1099511628211ULL;
+    return value;
+}
+
+// readRecord: Reads one CSV record, which may span lines inside quotes.
+bool SponsorStore::readRecord(QIODevice *csv, QList<QByteArray> *fields) {
+    fields->clear();
+    QByteArray line = csv->readLine();
+    if (line.isEmpty()) return false;
+    while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
+    if (!line.contains('"')) {
+        *fields = line.split(','); // Most rows: no quoted descriptions or user agents
+        return true;
+    }
+    QByteArray field;
+    bool quoted = false;
+    for (;;) {
+        for (int i = 0; i < line.size(); ++i) {
+            char c = line.at(i);
+            if (quoted && c == '"' && i + 1 < line.size() && line.at(i + 1) == '"') {
+                field += '"'; // Escaped quote
+                ++i;
+            } else if (c == '"') {
+                quoted = !quoted;
+            } else if (c == ',' && !quoted) {
+                *fields << field;
+                field.clear();
+            } else {
+                field += c;
+            }
+        }
+        if (!quoted) break;
+        // A line break inside quotes belongs to the field
+        line = csv->readLine();
+        if (line.isEmpty()) break; // Unterminated quote at the end of the dump
+        field += '\n';
+        while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
+    }
+    *fields << field;
+    return true;
+}
+
+// import: Builds a store file from a sponsorTimes.csv dump; summary gets the counts or the error.
+bool SponsorStore::import(QIODevice *csv, const QString &path, QString *summary) {
+    QList<QByteArray> fields;
+    if (!readRecord(csv, &fields)) {
+        *summary = "The dump is empty";
+        return false;
+    }
+    // Columns are found by name, so reordered or added columns do not matter
+    const QList<QByteArray> header = fields;
+    auto column = [&header](const char *name) { return header.indexOf(QByteArray(name)); };
+    int idColumn = column("videoID"), startColumn = column("startTime"), endColumn = column("endTime");
+    int votesColumn = column("votes"), lockedColumn = column("locked"), categoryColumn = column("category");
+    int actionColumn = column("actionType"), serviceColumn = column("service");
+    int hiddenColumn = column("hidden"), shadowColumn = column("shadowHidden");
+    if (idColumn < 0 || startColumn < 0 || endColumn < 0) {
+        *summary = "Not a sponsorTimes.csv dump: it has no videoID, startTime and endTime columns";
+        return false;
+    }
+    QSet<QByteArray> wanted;
+    for (const QString &category : categories()) wanted.insert(category.toUtf8());
+    auto field = [&fields](int index) { return index >= 0 ? fields.value(index) : QByteArray(); };
+
+    QHash<QByteArray, QVector<float>> videos; // Start/end pairs by video id
+    qint64 rows = 0, kept = 0;
+    while (readRecord(csv, &fields)) {
+        ++rows;
+        QByteArray id = field(idColumn);
+        if (id.isEmpty() || id.size() > 255) continue;
+        if (categoryColumn >= 0 && !wanted.contains(field(categoryColumn))) continue;
+        QByteArray action = field(actionColumn), service = field(serviceColumn);
+        if ((!action.isEmpty() && action != "skip") || (!service.isEmpty() && service != "YouTube")) continue;
+        if (field(hiddenColumn) == "1" || field(shadowColumn) == "1") continue;
+        // Stricter than the API's default: downvoted segments stay unless a moderator locked them
+        if (field(votesColumn).toInt() < 0 && field(lockedColumn) != "1") continue;
+        float start = field(startColumn).toFloat(), end = field(endColumn).toFloat();
+        if (!(end > start)) continue;
+        QVector<float> &segments = videos[id];
+        if (segments.size() >= 2 * 65535) continue;
+        segments << start << end;
+        ++kept;
+    }
+
+    // Open addressing stays fast while at most half the slots are used
+    quint64 slotCount = 1;
+    while (slotCount < quint64(videos.size()) * 2) slotCount <<= 1;
+    QVector<quint64> table(int(slotCount), 0);
+    quint64 offset = HeaderSize + slotCount * 8;
+    for (auto it = videos.constBegin(); it != videos.constEnd(); ++it) {
+        quint64 slot = hash(it.key()) & (slotCount - 1);
+        while (table.at(int(slot)) != 0) slot = (slot + 1) & (slotCount - 1);
+        table[int(slot)] = offset;
+        offset += 3 + it.key().size() + it.value().size() * 4;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile out(path); // Replaced in one rename; a running app keeps its mapping of the old file
+    if (!out.open(QIODevice::WriteOnly)) {
+        *summary = QString("Cannot write %1: %2").arg(path, out.errorString());
+        return false;
+    }
+    QByteArray block("YTSB", 4);
+    quint32 version = 1;
+    quint64 videoCount = quint64(videos.size()), segmentCount = quint64(kept);
+    block.append(reinterpret_cast<const char *>(&version), sizeof version);
+    block.append(reinterpret_cast<const char *>(&slotCount), sizeof slotCount);
+    block.append(reinterpret_cast<const char *>(&videoCount), sizeof videoCount);
+    block.append(reinterpret_cast<const char *>(&segmentCount), sizeof segmentCount);
+    block.append(reinterpret_cast<const char *>(table.constData()), int(slotCount * 8));
+    // Records in the order the offsets were assigned
+    for (auto it = videos.constBegin(); it != videos.constEnd(); ++it) {
+        quint16 count = quint16(it.value().size() / 2);
+        block.append(char(it.key().size()));
+        block.append(it.key());
+        block.append(reinterpret_cast<const char *>(&count), sizeof count);
+        block.append(reinterpret_cast<const char *>(it.value().constData()), it.value().size() * 4);
+        if (block.size() >= (1 << 20)) {
+            out.write(block);
+            block.clear();
+        }
+    }
+    out.write(block);
+    if (!out.commit()) {
+        *summary = QString("Cannot write %1: %2").arg(path, out.errorString());
+        return false;
+    }
+    *summary = QString("%1 segments of %2 videos kept from %3 rows").arg(kept).arg(videos.size()).arg(rows);
+    return true;
+}
+
+// Rendition: One of several outputs a job derives from a single download.
+struct Rendition {
+    // Kind: How the output is made from the downloaded streams.
+    enum Kind { Remux, Audio, Downscale };
+
+    Kind kind = Remux; // Remux follows the plan's container policy, Audio converts to MP3, Downscale re-encodes
+    int height = 0; // Height of a downscaled copy
+    QString audioBitrate = "192k"; // Bitrate of the MP3
+
+    // label: Short name for the jobs table and the log, e.g. "480p".
+    QString label() const { return kind == Audio ? QString("MP3") : kind == Downscale ? QString("%1p").arg(height) : QString("video"); }
+    bool operator==(const Rendition &other) const {
+        return kind == other.kind && height == other.height && audioBitrate == other.audioBitrate;
+    }
+};
+
+// PostprocessPlan: ffmpeg work that turns a job's raw download into the final file.
+struct PostprocessPlan {
+    QString container; // Container policy for video ("auto", "mp4", "webm", "mkv"), empty for audio only
+    bool audioOnly = false; // Keep only the audio stream
+    QString audioCodec; // Audio-only conversion ("mp3"), empty to keep the native stream
+    QString audioBitrate; // Bitrate of the conversion, e.g. "320k"
+    bool removeSponsors = false; // Cut SponsorBlock segments
+    double offset = 0; // Start of a downloaded section within the video; SponsorBlock times shift by it
+    bool splitChapters = false; // Also write every chapter to a file of its own
+    QJsonArray chapters; // Probed chapters of the item (start_time, end_time, title), set per job
+    QList<Rendition> renditions; // Outputs derived from the one download, empty for a single file; chapters come from the first
+    int files = 1; // Raw files yt-dlp writes per item (2 when video and audio are separate formats)
+
+    // isNeeded: False when the raw download already is the final file.
+    bool isNeeded() const {
+        return !container.isEmpty() || !audioCodec.isEmpty() || removeSponsors || splitChapters || !renditions.isEmpty();
+    }
+    // operator==: Same work for every item; the per-item chapters do not keep jobs from sharing a run.
+    bool operator==(const PostprocessPlan &other) const {
+        return container == other.container && audioOnly == other.audioOnly && audioCodec == other.audioCodec
+            && audioBitrate == other.audioBitrate && removeSponsors == other.removeSponsors && offset == other.offset
+            && splitChapters == other.splitChapters && renditions == other.renditions && files == other.files;
+    }
+};
+
+// Postprocessor: Pipeline stage that merges, transcodes and cuts raw downloads with ffmpeg.
+// yt-dlp only downloads; its slot is free as soon as the network part is done. Tasks here
+// run on a pool bounded by the core count: a stream copy or audio encode takes one core,
+// a video encode takes half of them, so concurrent ffmpeg passes never oversubscribe the CPU.
+// Cuts in stream-copied video start at a keyframe within YTDLP_GUI_CUT_SLACK seconds
+// (default 1) of the wanted time, or else only the frames up to the next keyframe are
+// re-encoded (H.264, VP8 and VP9), so cutting costs CPU per cut rather than per minute of video. Chapter pieces
+// are stream copies of the finished file that run side by side, a core each, each reading
+// only its own range, so the file is read once however many chapters it has. Renditions are
+// pieces too: each reads the raw files (through the same cut lists) and they run side by side;
+// the chapters are then pieces of the first rendition, split once it is written.
+class Postprocessor : public QObject {
+    Q_OBJECT
+public:
+    // Constructor: Creates an idle stage sized to the number of cores.
+    explicit Postprocessor(QObject *parent = nullptr);
+    // submit: Queues the raw files of one download and returns the task id.
+    int submit(const QString &videoId, const QStringList &rawFiles, const PostprocessPlan &plan,
+               const ProcessPriority &priority);
+    // isIdle: True when no task is analyzing, waiting or running.
+    bool isIdle() const { return tasks.isEmpty(); }
+    // setPressure: Uses half the cores while the machine is under pressure and one task at a time when critical.
+    void setPressure(PressureMonitor::Level level);
+
+signals:
+    // progress: Emitted when a task's phase or progress (0-100) changes.
+    void progress(int taskId, const QString &phase, double percent);
+    // finished: Emitted once per task with the final files (the whole file or the renditions
+    // first, then the chapters) or the failure reason, and the resources its cgroup measured.
+    void finished(int taskId, bool ok, const QStringList &files, const QString &error, const CgroupUsage &usage);
+    // renditionProgress: Emitted when the phase or progress (0-100) of one of a task's renditions changes.
+    void renditionProgress(int taskId, int rendition, const QString &phase, double percent);
+    // renditionFinished: Emitted once per rendition with its file or the failure reason.
+    void renditionFinished(int taskId, int rendition, bool ok, const QString &file, const QString &error);
+    // logMessage: Emitted for conditions the user should know about, e.g. an unreachable API.
+    void logMessage(const QString &message);
+
+private:
+    // Task: One job's postprocessing, from analysis to the final ffmpeg pass.
+    struct Task {
+        int id = 0; // Task id
+        QString videoId; // yt-dlp id, used for the SponsorBlock lookup
+        QStringList rawFiles; // Files written by yt-dlp
+        PostprocessPlan plan; // What to do with them
+        ProcessPriority priority; // Scheduling class of ffprobe and ffmpeg
+        QString cgroup; // cgroup of ffprobe and ffmpeg, empty without cgroups
+        QStringList vcodecs; // Codec family of the first video stream of each raw file, empty if none
+        QStringList acodecs; // Codec family of the first audio stream of each raw file, empty if none
+        QString pixelFormat; // Pixel format of the first video stream, for re-encoded cut boundaries
+        QString videoProfile; // Its profile as ffprobe names it, e.g. "High"
+        int videoLevel = 0; // Its level times ten (H.264), 0 when unknown
+        QString videoTimeBase; // Its time base, e.g. "1/15360"
+        double duration = 0; // Longest raw file, in seconds
+        QList<QPair<double, double>> cuts; // SponsorBlock segments to remove, in seconds
+        QJsonArray chapters; // Chapters ffprobe found in the raw files, in video time, for items probed without them
+        bool keyframesProbed = false; // Keyframes around the cuts have been looked up
+        QList<double> keyframes; // Video keyframe times around the cuts, sorted
+        int pendingLookups = 0; // ffprobe runs and API requests still outstanding
+        QList<QStringList> passes; // ffmpeg passes run before args, e.g. re-encoded cut boundaries
+        int pass = 0; // Passes finished so far
+        QStringList args; // ffmpeg arguments
+        QString phase; // Description shown while ffmpeg runs
+        QString destination; // Final file
+        double outputDuration = 0; // Length of the output, for progress
+        int threads = 1; // Cores the ffmpeg pass may use
+        QTemporaryDir *scratch = nullptr; // Concat lists and re-encoded boundaries for cutting
+        QProcess *process = nullptr; // Running ffmpeg
+        QByteArray buffer; // Incomplete progress line
+        Task *parent = nullptr; // Task or rendition a piece belongs to, nullptr for a job's task
+        int rendition = -1; // Index in the parent's renditions, -1 for a chapter piece
+        QList<Task *> pieces; // Chapter or rendition pieces to run once the output (or the cut lists) is written
+        int pieceCount = 0; // Pieces queued by split
+        int piecesLeft = 0; // Pieces running or waiting
+        QStringList outputs; // Pieces written so far; one entry per rendition, empty until it is written
+        QString error; // First failure of a chapter piece, or every failed rendition
+    };
+
+    // probeFile: Reads the stream codecs and duration of one raw file with ffprobe.
+    void probeFile(Task *task, int file);
+    // fetchSegments: Looks up the video's SponsorBlock segments, in the local store first.
+    void fetchSegments(Task *task);
+    // probeKeyframes: Reads the video keyframes near the start of every kept range.
+    void probeKeyframes(Task *task, int file);
+    // lookupDone: Plans the ffmpeg pass once every lookup has answered.
+    void lookupDone(Task *task);
+    // prepare: Builds the ffmpeg command; returns false with an error if the files are unusable.
+    bool prepare(Task *task, QString *error);
+    // dispatch: Starts waiting tasks while cores are free.
+    void dispatch();
+    // start: Takes a task's cores and runs its ffmpeg passes.
+    void start(Task *task);
+    // runPass: Runs a task's next ffmpeg pass, the final one last.
+    void runPass(Task *task);
+    // split: Queues a task's pieces once its output or cut lists are written, or finishes it.
+    void split(Task *task);
+    // readProgress: Parses ffmpeg's -progress output.
+    void readProgress(Task *task);
+    // finish: Reports a task's result and frees its cores.
+    void finish(Task *task, bool ok, const QString &error);
+    // claimName: Reserves the first name for an output that neither exists nor is another
+    // task's, e.g. "Title (2).mp4" when "Title.mp4" is already in the folder.
+    QString claimName(const QString &path);
+    // discard: Deletes a piece that never ran, with its own pieces, and frees their names.
+    void discard(Task *task);
+
+    QHash<int, Task *> tasks; // All unfinished tasks by id
+    QSet<QString> claimed; // Outputs of unfinished tasks, so no file is ever written twice
+    QList<Task *> waiting; // Tasks ready to run, in order
+    QNetworkAccessManager *network; // SponsorBlock API client
+    SponsorStore sponsors; // Imported segments and recent lookups
+    QString sponsorApi; // SponsorBlock API base URL, empty to use the local store only
+    double cutSlack; // Seconds a cut may move to land on a keyframe
+    int nextTaskId = 1; // Id of the next task
+    int maxThreads; // Cores of the machine
+    int coreLimit; // Cores the stage may use under the current pressure
+    int usedThreads = 0; // Cores taken by running tasks
+};
+
+// DownloadJob: One item (a single video) handled by the download engine.
+struct DownloadJob {
+    // State: Lifecycle of a job.
+    enum State { Queued, Running, Completed, Failed };
+
+    int id = 0; // Engine-assigned job id
+    QString url; // URL handed to yt-dlp
+    QString videoId; // yt-dlp id, used to demultiplex shared runs
+    QString title; // Display title
+    QString channel; // Uploader or channel name, empty when unknown
+    QString thumbnail; // Thumbnail URL, empty when unknown
+    double duration = 0; // Length in seconds, 0 when unknown
+    QStringList options; // yt-dlp arguments except the URL
+    PostprocessPlan plan; // ffmpeg work after the download
+    ProcessPriority priority; // Scheduling class of the processes serving the job
+    QString effectivePriority; // Settings read back from the download process
+    CgroupUsage usage; // Measured in the job's cgroups; a batched run's CPU and I/O are split evenly
+    QStringList rawFiles; // Files yt-dlp has written so far
+    State state = Queued; // Current lifecycle state
+    QString phase; // What the job is doing right now ("downloading", "Merger", ...)
+    double percent = 0; // Download progress, 0-100
+    qint64 downloadedBytes = 0; // Bytes downloaded so far
+    qint64 totalBytes = 0; // Expected size, 0 when unknown
+    double speed = 0; // Bytes per second
+    int eta = -1; // Seconds remaining, -1 when unknown
+    QString destination; // Final file path once completed
+    QStringList outputs; // Every file the job produced, destination first (e.g. chapter pieces after it)
+    // Output: Progress and result of one rendition of a multi-rendition job.
+    struct Output {
+        QString label; // Rendition name, e.g. "480p"
+        QString phase; // What it is doing, "done" or "failed" at the end
+        double percent = 0; // Progress of its ffmpeg pass, 0-100
+        QString file; // Its file once written
+        QString error; // Failure reason
+    };
+    QList<Output> renditions; // One per rendition of the plan, empty for a single-output job
+    QString error; // Failure reason
+    QString targetDir; // Save folder, empty when the caller did not name one
+    bool staged = false; // Written in the staging area and moved to targetDir when done
+    qint64 sizeEstimate = 0; // Expected size of the downloaded files, 0 when unknown
+    qint64 writtenBytes = 0; // Bytes the download has written so far, over all its files
+};
+
+// estimateSize: Expected download size of an item for a -f value; defined with the format helpers.
+static qint64 estimateSize(const QJsonObject &metadata, const QString &formatSpec);
+// thumbnailUrl: Thumbnail of a probed video or playlist entry; defined with the thumbnail cache.
+static QString thumbnailUrl(const QJsonObject &metadata);
+
+// ConcurrencyController: AIMD hill climber for download slots and per-run fragment threads.
+// Every interval it compares the aggregate throughput with the previous interval. Errors that
+// signal throttling halve both knobs (multiplicative decrease); an increase that did not pay
+// off is undone and followed by a short hold; otherwise one knob grows by one (additive
+// increase): slots while jobs are waiting for one, fragments otherwise.
+class ConcurrencyController {
+public:
+    // update: Feeds one interval's measurements; returns a log line when the settings changed.
+    QString update(double bytesPerSecond, int errors, bool jobsWaiting) {
+        QString before = QString("%1 run(s) x %2 fragment(s)").arg(slots).arg(fragments);
+        QString why;
+        if (errors > 0) {
+            slots = qMax(1, slots / 2);
+            fragments = qMax(1, fragments / 2);
+            lastStep = None;
+            holdIntervals = 2;
+            why = QString("%1 throttling error(s)").arg(errors);
+        } else if (lastStep != None && bytesPerSecond < lastThroughput * 1.05) {
+            // The last increase bought less than 5%: step back and stay there for a while
+            if (lastStep == Slots) slots = qMax(1, slots - 1);
+            if (lastStep == Fragments) fragments = qMax(1, fragments - 1);
+            lastStep = None;
+            holdIntervals = 3;
+            why = QString("no gain from the last step (%1 -> %2/s)").arg(rateText(lastThroughput), rateText(bytesPerSecond));
+        } else if (holdIntervals > 0) {
+            --holdIntervals;
+            lastStep = None;
+        } else if (jobsWaiting && slots < maxSlots) {
+            ++slots;
+            lastStep = Slots;
+            why = QString("probing for more throughput at %1/s").arg(rateText(bytesPerSecond));
+        } else if (fragments < maxFragments) {
+            ++fragments;
+            lastStep = Fragments;
+            why = QString("probing for more throughput at %1/s").arg(rateText(bytesPerSecond));
+        }
+        lastThroughput = bytesPerSecond;
+        QString after = QString("%1 run(s) x %2 fragment(s)").arg(slots).arg(fragments);
+        return after == before ? QString() : QString("Concurrency: %1 -> %2 (%3)").arg(before, after, why);
+    }
+    // slotCount: Download runs that may be active at once.
+    int slotCount() const { return slots; }
+    // fragmentCount: --concurrent-fragments for newly started runs.
+    int fragmentCount() const { return fragments; }
+
+private:
+    // Step: The knob the last interval increased.
+    enum Step { None, Slots, Fragments };
+
+    // rateText: Formats a byte rate, e.g. "12.3 MB".
+    static QString rateText(double bytesPerSecond) { return QString("%1 MB").arg(bytesPerSecond / (1 << 20), 0, 'f', 1); }
+
+    int slots = 2; // Active download runs allowed
+    int fragments = 1; // Fragment threads per run
+    int maxSlots = 8; // Upper bound for slots
+    int maxFragments = 16; // Upper bound for fragments
+    double lastThroughput = 0; // Bytes per second in the previous interval
+    Step lastStep = None; // Increase made after the previous interval
+    int holdIntervals = 0; // Intervals to wait before increasing again
+};
+
+// parseByteSize: Parses "500K", "2M", "1.5G" or a plain number of bytes.
+static qint64 parseByteSize(QString text) {
+    text = text.trimmed().toUpper();
+    double factor = 1;
+    if (text.endsWith('K')) factor = 1024;
+    if (text.endsWith('M')) factor = 1024 * 1024;
+    if (text.endsWith('G')) factor = 1024.0 * 1024 * 1024;
+    if (factor > 1) text.chop(1);
+    return qint64(text.toDouble() * factor);
+}
+
+// sizeText: Formats a byte count for display, e.g. "312 MB".
+static QString sizeText(qint64 bytes, bool estimate = false) {
+    if (bytes <= 0) return "size unknown";
+    QString prefix = estimate ? "~" : "";
+    if (bytes >= qint64(1) << 30) return prefix + QString("%1 GB").arg(bytes / double(qint64(1) << 30), 0, 'f', 1);
+    if (bytes >= qint64(1) << 20) return prefix + QString("%1 MB").arg(bytes / double(qint64(1) << 20), 0, 'f', 0);
+    return prefix + QString("%1 KB").arg(qMax<qint64>(1, bytes >> 10));
+}
+
+// durationText: Formats seconds as "m:ss" or "h:mm:ss".
+static QString durationText(qint64 seconds) {
+    QString minutesAndSeconds = QString("%1:%2").arg(seconds / 60 % 60).arg(seconds % 60, 2, 10, QChar('0'));
+    if (seconds < 3600) return minutesAndSeconds;
+    return QString("%1:%2").arg(seconds / 3600).arg(minutesAndSeconds.rightJustified(5, '0'));
+}
+
+// timestampText: Formats seconds like durationText, keeping milliseconds when there are any.
+static QString timestampText(double seconds) {
+    QString text = durationText(qint64(seconds));
+    double fraction = seconds - qint64(seconds);
+    if (fraction >= 0.0005) text += QString::number(fraction, 'f', 3).mid(1);
+    return text;
+}
+
+// parseTimestamp: Seconds in "s", "m:ss" or "h:mm:ss", fractions allowed; -1 when malformed.
+static double parseTimestamp(const QString &text) {
+    QStringList parts = text.trimmed().split(':');
+    if (parts.size() > 3) return -1;
+    double seconds = 0;
+    for (const QString &part : parts) {
+        bool ok = false;
+        double value = part.toDouble(&ok);
+        if (!ok || value < 0) return -1;
+        seconds = seconds * 60 + value;
+    }
+    return seconds;
+}
+
+// parseSections: Time ranges such as "1:00-1:30, 2:05:00-2:05:30", sorted; on a malformed
+// range the list is empty and error names it.
+static QList<QPair<double, double>> parseSections(const QString &text, QString *error) {
+    QList<QPair<double, double>> sections;
+    for (const QString &item : text.split(QRegularExpression("[,;]"), Qt::SkipEmptyParts)) {
+        if (item.trimmed().isEmpty()) continue;
+        double start = parseTimestamp(item.section('-', 0, 0)), end = parseTimestamp(item.section('-', 1));
+        if (!item.contains('-') || start < 0 || end <= start) {
+            if (error) *error = QString("'%1' is not a time range like 1:00-1:30").arg(item.trimmed());
+            return {};
+        }
+        sections << qMakePair(start, end);
+    }
+    std::sort(sections.begin(), sections.end());
+    return sections;
+}
+
+// BandwidthBudget: A global download rate budget that follows a time-of-day schedule and is
+// split across running downloads by weight. YTDLP_GUI_BANDWIDTH holds ";"-separated entries,
+// either a default rate or "HH:MM-HH:MM=rate" windows, with K/M/G byte suffixes and 0 for
+// unlimited, e.g. "2M;22:00-07:00=0" for 2 MB/s by day and no limit at night.
+class BandwidthBudget {
+public:
+    // Constructor: Parses a schedule; an empty one means unlimited at all times.
+    explicit BandwidthBudget(const QString &schedule) {
+        for (const QString &entry : schedule.split(';', Qt::SkipEmptyParts)) {
+            QString range = entry.section('=', 0, 0).trimmed();
+            if (!entry.contains('=')) {
+                defaultRate = parseByteSize(range);
+                continue;
+            }
+            Window window;
+            window.from = QTime::fromString(range.section('-', 0, 0).trimmed(), "HH:mm");
+            window.to = QTime::fromString(range.section('-', 1, 1).trimmed(), "HH:mm");
+            window.rate = parseByteSize(entry.section('=', 1, 1));
+            if (window.from.isValid() && window.to.isValid()) windows << window;
+        }
+    }
+    // budgetAt: Bytes per second available at a time of day, 0 for unlimited.
+    qint64 budgetAt(const QTime &time) const {
+        for (const Window &window : windows) {
+            // Windows may wrap around midnight, e.g. 22:00-07:00
+            bool inside = window.from <= window.to ? time >= window.from && time < window.to
+                                                   : time >= window.from || time < window.to;
+            if (inside) return window.rate;
+        }
+        return defaultRate;
+    }
+    // split: Water-filling split of a budget by weight. A run whose demand (-1 for unknown)
+    // is below its share gets its demand; what it leaves is shared among the others.
+    static QList<qint64> split(qint64 budget, const QList<double> &weights, const QList<double> &demands) {
+        QList<qint64> limits;
+        QList<int> open;
+        for (int i = 0; i < weights.size(); ++i) {
+            limits << 0;
+            open << i;
+        }
+        double remaining = budget;
+        bool capped = true;
+        while (capped && !open.isEmpty()) {
+            capped = false;
+            double weightSum = 0;
+            for (int i : open) weightSum += weights.at(i);
+            for (auto it = open.begin(); it != open.end();) {
+                double share = remaining * weights.at(*it) / weightSum;
+                if (demands.at(*it) >= 0 && demands.at(*it) < share) {
+                    limits[*it] = qint64(demands.at(*it));
+                    remaining -= demands.at(*it);
+                    it = open.erase(it);
+                    capped = true;
+                    break; // Shares change once a run is capped
+                }
+                ++it;
+            }
+        }
+        double weightSum = 0;
+        for (int i : open) weightSum += weights.at(i);
+        for (int i : open) limits[i] = qint64(remaining * weights.at(i) / weightSum);
+        return limits;
+    }
+
+private:
+    // Window: A time-of-day range with its own rate.
+    struct Window {
+        QTime from; // Start, inclusive
+        QTime to; // End, exclusive
+        qint64 rate = 0; // Bytes per second, 0 for unlimited
+    };
+
+    QList<Window> windows; // Scheduled rates, first match wins
+    qint64 defaultRate = 0; // Rate outside every window
+};
+
+// FileMover: Moves finished files from the staging area to their final folder on a
+// background thread. A rename is used when both are on one filesystem; otherwise the
+// file is copied (copy_file_range on Linux, so the kernel or NFS server does the work),
+// synced, renamed into place and only then removed from staging. Moves run one at a
+// time so a slow network share sees one sequential writer.
+class FileMover : public QObject {
+    Q_OBJECT
+public:
+    // Constructor: Creates an idle mover.
+    explicit FileMover(QObject *parent = nullptr) : QObject(parent) {}
+    // Destructor: Abandons the copy in progress and waits for its thread.
+    ~FileMover() override;
+    // move: Queues a file to be moved into a folder and returns the task id.
+    int move(const QString &source, const QString &targetDir);
+    // isIdle: True when no move is queued or running.
+    bool isIdle() const { return pending.isEmpty() && !thread; }
+    // pendingBytes: Size of the files still waiting in staging.
+    qint64 pendingBytes() const;
+
+signals:
+    // progress: Emitted as a copy advances.
+    void progress(int taskId, double percent);
+    // finished: Emitted once a file is in place (or the move failed and it stayed in staging).
+    void finished(int taskId, bool ok, const QString &destination, const QString &error);
+
+private:
+    // Task: One queued move.
+    struct Task {
+        int id = 0; // Task id returned by move()
+        QString source; // File in staging
+        QString destination; // Final path
+        QString error; // Set by the thread on failure
+    };
+
+    // startNext: Starts the thread for the next queued move.
+    void startNext();
+    // transfer: Renames or copies a file without replacing one already there; runs on the mover
+    // thread, updates the destination to the name used and returns an error message.
+    QString transfer(const QString &source, QString *destination, int taskId);
+
+    QList<Task> pending; // Moves waiting to start
+    Task current; // Move the thread is working on
+    QThread *thread = nullptr; // Running move, nullptr when idle
+    QAtomicInt abort; // Set to make the thread give up
+    int nextTaskId = 1; // Id of the next task
+};
+
+// DownloadEngine: Runs queued jobs through warm workers or yt-dlp processes.
+// Short items with identical options are grouped into one run, so one yt-dlp
+// (or one worker job) serves many URLs; its output is demultiplexed back into
+// per-job states by video id. Runs only download; a job's raw files are then
+// handed to the Postprocessor stage while the run slot moves on.
+class DownloadEngine : public QObject {
+    Q_OBJECT
+public:
+    // Constructor: Creates an idle engine; the given worker pool serves interactive jobs.
+    explicit DownloadEngine(WorkerPool *workerPool, QObject *parent = nullptr);
+    // enqueue: Queues one item with its probed metadata and returns the job id.
+    // targetDir is the save folder; with a staging area options should write to stagingDir() instead.
+    int enqueue(const QString &url, const QJsonObject &metadata, const QStringList &options,
+                const PostprocessPlan &plan = PostprocessPlan(),
+                const ProcessPriority &priority = ProcessPriority::named("interactive"),
+                const QString &targetDir = QString());
+    // job: Returns the current state of a job, or an empty job for an unknown id.
+    const DownloadJob &job(int jobId) const {
+        static const DownloadJob none = DownloadJob();
+        auto found = jobs.constFind(jobId);
+        return found != jobs.constEnd() ? found.value() : none;
+    }
+    // isIdle: True when no job is queued, downloading or postprocessing.
+    bool isIdle() const { return queue.isEmpty() && runs.isEmpty() && postprocessing.isEmpty() && moving.isEmpty(); }
+    // stagingDir: Local scratch folder downloads are written to, empty when they go straight to their folder.
+    QString stagingDir() const { return staging; }
+    // projectedUsage: Disk space the unfinished jobs are expected to need, per filesystem.
+    QString projectedUsage() const;
+    // setPressure: Adapts admission to a pressure sample: one run fewer per elevated sample,
+    // one more per normal sample, and bulk runs paused while the level is critical.
+    void setPressure(PressureMonitor::Level level, const QString &reason);
+
+signals:
+    // jobChanged: Emitted whenever a job's state or progress changes.
+    void jobChanged(int jobId);
+    // logMessage: Emitted for yt-dlp output that does not belong to a progress update.
+    void logMessage(const QString &message);
+    // idle: Emitted when the last running job has finished.
+    void idle();
+
+private slots:
+    // workerEvent: Applies a warm worker's event to the job it belongs to.
+    void workerEvent(WorkerPool *workerPool, int workerJob, const QJsonObject &event);
+    // workerFinished: Settles the jobs of a run served by a warm worker.
+    void workerFinished(WorkerPool *workerPool, int workerJob, bool ok, const QString &error);
+    // workerRejected: Re-runs a run the pool could not take in a spawned yt-dlp.
+    void workerRejected(WorkerPool *workerPool, int workerJob);
+    // postprocessProgress: Shows a postprocessing task's phase on its job.
+    void postprocessProgress(int taskId, const QString &phase, double percent);
+    // renditionProgress: Shows the phases of a job's renditions side by side.
+    void renditionProgress(int taskId, int rendition, const QString &phase, double percent);
+    // renditionFinished: Records the file or failure of one of a job's renditions.
+    void renditionFinished(int taskId, int rendition, bool ok, const QString &file, const QString &error);
+    // postprocessFinished: Completes or fails the job of a postprocessing task.
+    void postprocessFinished(int taskId, bool ok, const QStringList &files, const QString &error,
+                             const CgroupUsage &usage);
+    // moveProgress: Shows how far a job's file has been copied out of staging.
+    void moveProgress(int taskId, double percent);
+    // moveFinished: Completes the job whose files are now all in its folder.
+    void moveFinished(int taskId, bool ok, const QString &destination, const QString &error);
+
+private:
+    // Run: One executor (worker job or yt-dlp process) serving one or more jobs.
+    struct Run {
+        QList<int> jobIds; // Jobs served, in submission order
+        QStringList args; // yt-dlp arguments shared by all jobs of the run, without URLs
+        ProcessPriority priority; // Scheduling class shared by all jobs of the run
+        bool priorityReported = false; // Effective settings have been read back
+        bool paused = false; // Stopped because the machine is under critical pressure
+        bool restarting = false; // Spawned yt-dlp is being restarted with a new rate limit
+        qint64 rateLimit = 0; // --limit-rate in bytes per second, 0 for unlimited
+        QElapsedTimer age; // Time since the run (or its last restart) started
+        QProcess *process = nullptr; // Spawned yt-dlp, if not on a worker
+        WorkerPool *workerPool = nullptr; // Pool serving the run, if on a worker
+        int workerJob = -1; // Worker job id, if on a worker
+        QString cgroup; // cgroup of the serving process, empty without cgroups
+        CgroupUsage baseline; // Usage of a worker's cgroup before the run, subtracted at the end
+        int currentJob = -1; // Job the run is working on right now
+        QByteArray buffer; // Incomplete output line
+        QString lastError; // Last error not attributed to a job
+    };
+
+    // schedule: Starts runs for queued jobs while run slots are free.
+    void schedule();
+    // spawnRun: Runs a batch in its own yt-dlp process fed by --batch-file.
+    void spawnRun(Run *run);
+    // readRun: Splits a spawned run's output into lines.
+    void readRun(Run *run);
+    // handleRunLine: Demultiplexes one line of a spawned run's output.
+    void handleRunLine(Run *run, const QString &line);
+    // handleError: Attributes an "ERROR:" message to the job it names, or the current one.
+    void handleError(Run *run, const QString &message);
+    // fileDone: Records a file yt-dlp finished and moves the job on once it has all of them.
+    void fileDone(int jobId, const QString &path);
+    // startPostprocessing: Hands a job's raw files to the postprocessing stage.
+    void startPostprocessing(int jobId);
+    // finishRun: Postprocesses or fails jobs the run left unfinished and frees its slot.
+    void finishRun(Run *run, const QString &error);
+    // jobFor: Finds the job of a run by yt-dlp video id, or by the URL it was queued with.
+    int jobFor(Run *run, const QString &videoId, const QString &url = QString()) const;
+    // startItem: Makes the job yt-dlp starts the run's current one and learns its video id.
+    void startItem(Run *run, const QString &videoId, const QString &url);
+    // updateProgress: Stores progress numbers on a job.
+    void updateProgress(int jobId, double downloaded, double total, double speed, double eta);
+    // setState: Changes a job's state and phase and notifies listeners.
+    void setState(int jobId, DownloadJob::State state, const QString &phase);
+    // runForWorkerJob: Finds the run served by a worker job.
+    Run *runForWorkerJob(WorkerPool *workerPool, int workerJob) const;
+    // poolFor: The warm workers of a priority class, created on first use.
+    WorkerPool *poolFor(const ProcessPriority &priority);
+    // addPool: Registers the warm workers of a priority class and listens to their jobs.
+    void addPool(const QString &priorityName, WorkerPool *pool);
+    // reportPriority: Reads back the settings of the process serving a run and shows them.
+    void reportPriority(Run *run, qint64 pid);
+    // pauseRun: Freezes or resumes the process tree serving a run; false if it has none yet.
+    bool pauseRun(Run *run, bool pause);
+    // activeRuns: Runs that are not paused.
+    int activeRuns() const;
+    // noteLine: Counts output lines that show a host throttling or failing transfers.
+    void noteLine(const QString &line);
+    // tuneConcurrency: Feeds the last interval's throughput and errors to the controller.
+    void tuneConcurrency();
+    // bandwidthShares: Splits the current bandwidth budget across the active runs.
+    QHash<Run *, qint64> bandwidthShares() const;
+    // rebalanceBandwidth: Applies new shares to runs whose limit changed noticeably.
+    void rebalanceBandwidth();
+    // restartRun: Restarts a spawned run so a new rate limit takes effect; false if nothing is left to download.
+    bool restartRun(Run *run);
+    // isDownloading: True for a running job that has not reached postprocessing or the move yet.
+    bool isDownloading(int jobId) const;
+    // deliver: Completes a job, first moving its files out of staging when they were written there.
+    void deliver(int jobId, const QStringList &files);
+    // stagingUsage: Bytes in the staging area plus what running downloads are still expected to add.
+    qint64 stagingUsage() const;
+    // diskNeeds: Bytes a job has yet to write, by filesystem root.
+    QHash<QString, qint64> diskNeeds(const DownloadJob &job) const;
+    // fitsOnDisk: True when a job's needs fit next to what running jobs have reserved.
+    bool fitsOnDisk(const DownloadJob &job, const QHash<QString, qint64> &reserved) const;
+    // filesystemOf: Root of the filesystem holding a folder, cached.
+    QString filesystemOf(const QString &dir) const;
+
+    QHash<int, DownloadJob> jobs; // All jobs by id, including finished ones
+    QList<int> queue; // Jobs waiting for a run, in order
+    QList<Run *> runs; // Active runs
+    QHash<QString, WorkerPool *> pools; // Warm workers by priority class, preferred over spawning yt-dlp
+    Postprocessor *postprocessor; // ffmpeg stage after the download
+    QHash<int, int> postprocessing; // Job id by postprocessing task id
+    FileMover *mover; // Moves finished files out of staging
+    QHash<int, int> moving; // Job id by move task id
+    QHash<int, QString> movingFiles; // Staged file by move task id
+    QString staging; // Staging folder from YTDLP_GUI_STAGING, empty when disabled
+    qint64 stagingLimit = 0; // Bytes the staging area may hold
+    bool stagingFullShown = false; // Whether the current staging stall has been reported
+    mutable QHash<QString, QString> filesystems; // Filesystem root by folder
+    qint64 diskMargin = qint64(256) << 20; // Free space always left on a filesystem
+    int nextJobId = 1; // Id of the next enqueued job
+    bool cgroupStatusShown = false; // Whether jobs run in cgroups has been reported
+    int maxRuns = 2; // Concurrent runs, set by the controller
+    ConcurrencyController controller; // Tunes maxRuns and fragments from measured throughput
+    QTimer *tuningTimer; // Interval of controller decisions
+    QElapsedTimer tuningInterval; // Time since the last decision
+    qint64 intervalBytes = 0; // Bytes downloaded since the last decision
+    int intervalErrors = 0; // Throttling errors since the last decision
+    BandwidthBudget bandwidth; // Global rate budget from YTDLP_GUI_BANDWIDTH
+    qint64 currentBudget = 0; // Budget of the last rebalance, 0 for unlimited
+    int pressureLimit = 2; // Concurrent runs admitted under the current pressure
+    PressureMonitor::Level pressureLevel = PressureMonitor::Normal; // Last sampled pressure level
+    int batchLimit = 50; // Most jobs one run may serve
+    double smallItemSeconds = 600; // Items up to this length are batched
+};
+
+// Constructor implementation
+DownloadEngine::DownloadEngine(WorkerPool *workerPool, QObject *parent)
+    : QObject(parent), postprocessor(new Postprocessor(this)), mover(new FileMover(this)), tuningTimer(new QTimer(this)),
+      bandwidth(qEnvironmentVariable("YTDLP_GUI_BANDWIDTH")) {
+    addPool("interactive", workerPool);
+    // A subfolder, so usage accounting never counts unrelated files in e.g. /tmp
+    QString scratch = qEnvironmentVariable("YTDLP_GUI_STAGING");
+    if (!scratch.isEmpty() && QDir().mkpath(QDir(scratch).filePath("youtube-dlp-gui"))) {
+        staging = QDir(scratch).filePath("youtube-dlp-gui");
+        stagingLimit = parseByteSize(qEnvironmentVariable("YTDLP_GUI_STAGING_MAX"));
+        if (stagingLimit <= 0) stagingLimit = QStorageInfo(staging).bytesAvailable() / 2;
+    }
+    connect(mover, &FileMover::progress, this, &DownloadEngine::moveProgress);
+    connect(mover, &FileMover::finished, this, &DownloadEngine::moveFinished);
+    tuningTimer->setInterval(5000);
+    connect(tuningTimer, &QTimer::timeout, this, &DownloadEngine::tuneConcurrency);
+    connect(postprocessor, &Postprocessor::progress, this, &DownloadEngine::postprocessProgress);
+    connect(postprocessor, &Postprocessor::renditionProgress, this, &DownloadEngine::renditionProgress);
+    connect(postprocessor, &Postprocessor::renditionFinished, this, &DownloadEngine::renditionFinished);
+    connect(postprocessor, &Postprocessor::finished, this, &DownloadEngine::postprocessFinished);
+    connect(postprocessor, &Postprocessor::logMessage, this, &DownloadEngine::logMessage);
+}
+
+// enqueue: Queues one item with its probed metadata and returns the job id.
+int DownloadEngine::enqueue(const QString &url, const QJsonObject &metadata, const QStringList &options,
+                            const PostprocessPlan &plan, const ProcessPriority &priority, const QString &targetDir) {
+    DownloadJob job;
+    job.id = nextJobId++;
+    job.url = url;
+    job.videoId = metadata["id"].toString();
+    job.title = metadata["title"].toString(url);
+    job.channel = metadata["channel"].toString(metadata["uploader"].toString());
+    job.thumbnail = thumbnailUrl(metadata);
+    job.duration = metadata["duration"].toDouble();
+    job.options = options;
+    job.plan = plan;
+    if (plan.splitChapters) job.plan.chapters = metadata["chapters"].toArray();
+    for (const Rendition &rendition : plan.renditions) {
+        DownloadJob::Output output;
+        output.label = rendition.label();
+        output.phase = "waiting for the download";
+        job.renditions << output;
+    }
+    job.priority = priority;
+    job.targetDir = targetDir;
+    job.staged = !staging.isEmpty() && !targetDir.isEmpty();
+    int format = options.indexOf("-f");
+    job.sizeEstimate = estimateSize(metadata, format >= 0 ? options.value(format + 1) : QString());
+    // A section download ("--download-sections *start-end") only fetches its ranges
+    double sectionLength = 0;
+    for (int i = options.indexOf("--download-sections"); i >= 0; i = options.indexOf("--download-sections", i + 1)) {
+        QString range = options.value(i + 1).mid(1);
+        double start = parseTimestamp(range.section('-', 0, 0)), end = parseTimestamp(range.section('-', 1));
+        if (start >= 0 && end > start) sectionLength += job.duration > 0 ? qMin(end, job.duration) - qMin(start, job.duration) : end - start;
+    }
+    if (sectionLength > 0) {
+        if (job.duration > 0) job.sizeEstimate = qint64(job.sizeEstimate * qMin(1.0, sectionLength / job.duration));
+        job.duration = sectionLength;
+    }
+    job.phase = "queued";
+    jobs.insert(job.id, job);
+    queue.append(job.id);
+    emit jobChanged(job.id);
+    QMetaObject::invokeMethod(this, [this] { schedule(); }, Qt::QueuedConnection);
+    return job.id;
+}
+
+// schedule: Starts runs for queued jobs while run slots are free.
+void DownloadEngine::schedule() {
+    if (!queue.isEmpty() && !cgroupStatusShown) {
+        cgroupStatusShown = true;
+        emit logMessage(CgroupTree::shared().status());
+        if (!staging.isEmpty()) emit logMessage(QString("Staging downloads in %1 (up to %2)").arg(staging, sizeText(stagingLimit)));
+    }
+    // Bulk jobs wait while the machine is under critical pressure
+    auto admissible = [this](int jobId) {
+        return pressureLevel != PressureMonitor::Critical || jobs[jobId].priority.name != "bulk";
+    };
+    // Space still to be written by every started job; a job starts only if its own needs fit beside it
+    QHash<QString, qint64> reserved;
+    for (const DownloadJob &job : jobs) {
+        if (job.state != DownloadJob::Running) continue;
+        const QHash<QString, qint64> needs = diskNeeds(job);
+        for (auto it = needs.begin(); it != needs.end(); ++it) reserved[it.key()] += it.value();
+    }
+    auto reserve = [this, &reserved](const DownloadJob &job) {
+        const QHash<QString, qint64> needs = diskNeeds(job);
+        for (auto it = needs.begin(); it != needs.end(); ++it) reserved[it.key()] += it.value();
+    };
+    while (activeRuns() < qMin(maxRuns, pressureLimit)) {
+        auto next = queue.end();
+        for (auto it = queue.begin(); it != queue.end(); ++it) {
+            if (!admissible(*it)) continue;
+            if (fitsOnDisk(jobs[*it], reserved)) {
+                next = it;
+                break;
+            }
+            if (jobs[*it].phase != "waiting for disk space") setState(*it, DownloadJob::Queued, "waiting for disk space");
+        }
+        if (next == queue.end()) {
+            // Nothing running will free space, so jobs that do not fit on their own never will
+            if (runs.isEmpty() && postprocessing.isEmpty() && moving.isEmpty()) {
+                for (auto it = queue.begin(); it != queue.end();) {
+                    if (!admissible(*it) || fitsOnDisk(jobs[*it], reserved)) {
+                        ++it;
+                        continue;
+                    }
+                    jobs[*it].error = QString("Not enough free disk space for this download (%1)").arg(sizeText(jobs[*it].sizeEstimate, true));
+                    setState(*it, DownloadJob::Failed, "failed");
+                    it = queue.erase(it);
+                }
+                if (isIdle()) emit idle();
+            }
+            break;
+        }
+        // A full staging area admits nothing until runs or moves free space; an idle engine still runs one
+        if (!staging.isEmpty() && (activeRuns() > 0 || !moving.isEmpty())) {
+            qint64 used = stagingUsage();
+            if (used >= stagingLimit) {
+                if (!stagingFullShown) {
+                    emit logMessage(QString("Staging area full (%1 of %2), holding %3 queued job(s)")
+                                        .arg(sizeText(used), sizeText(stagingLimit)).arg(queue.size()));
+                }
+                stagingFullShown = true;
+                break;
+            }
+        }
+        stagingFullShown = false;
+        auto *run = new Run;
+        const DownloadJob &head = jobs[*next];
+        queue.erase(next);
+        run->jobIds << head.id;
+        reserve(head);
+        // Short items share one run with later short items that use the same options
+        auto isSmall = [this](const DownloadJob &job) {
+            return job.duration > 0 && job.duration <= smallItemSeconds;
+        };
+        if (isSmall(head)) {
+            for (auto it = queue.begin(); it != queue.end() && run->jobIds.size() < batchLimit;) {
+                const DownloadJob &candidate = jobs[*it];
+                if (isSmall(candidate) && candidate.options == head.options && candidate.plan == head.plan
+                    && candidate.priority == head.priority && candidate.targetDir == head.targetDir
+                    && fitsOnDisk(candidate, reserved)) {
+                    run->jobIds << candidate.id;
+                    reserve(candidate);
+                    it = queue.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        // --ignore-errors keeps one failing item from aborting the others in the run
+        run->args = head.options;
+        run->args << "--ignore-errors" << "--concurrent-fragments" << QString::number(controller.fragmentCount());
+        run->priority = head.priority;
+        for (int jobId : run->jobIds) setState(jobId, DownloadJob::Running, "starting");
+        runs.append(run);
+        run->age.start();
+        run->rateLimit = bandwidthShares().value(run);
+        if (!tuningTimer->isActive()) {
+            tuningTimer->start();
+            tuningInterval.start();
+            intervalBytes = 0;
+            intervalErrors = 0;
+        }
+        if (run->jobIds.size() > 1) {
+            emit logMessage(QString("Downloading %1 short items in one yt-dlp run").arg(run->jobIds.size()));
+        }
+        WorkerPool *pool = poolFor(run->priority);
+        if (pool->isAvailable()) {
+            QJsonObject request;
+            request["op"] = "download";
+            QStringList args = run->args;
+            if (run->rateLimit > 0) args << "--limit-rate" << QString::number(run->rateLimit);
+            for (int jobId : run->jobIds) args << jobs[jobId].url;
+            request["args"] = QJsonArray::fromStringList(args);
+            run->workerPool = pool;
+            run->workerJob = pool->submit(request);
+        } else {
+            spawnRun(run);
+        }
+    }
+}
+
+// spawnRun: Runs a batch in its own yt-dlp process fed by --batch-file.
+void DownloadEngine::spawnRun(Run *run) {
+    // Machine-readable markers for item boundaries, progress and destinations
+    QStringList args = run->args;
+    if (run->rateLimit > 0) args << "--limit-rate" << QString::number(run->rateLimit);
+    args << "--newline" << "--progress" << "--no-simulate"
+         << "--progress-template"
+         << "download:[progress] %(info.id)s %(progress.downloaded_bytes)s %(progress.total_bytes)s "
+            "%(progress.total_bytes_estimate)s %(progress.speed)s %(progress.eta)s"
+         << "--print" << "before_dl:[item] %(id)s %(original_url)s"
+         << "--print" << "post_process:[postprocess] %(id)s"
+         << "--print" << "after_move:[done] %(id)s %(filepath)s"
+         << "--batch-file" << "-";
+    auto *process = new ChildProcess(run->priority, this);
+    run->cgroup = CgroupTree::shared().group(run->priority, QString("run-%1").arg(run->jobIds.first()));
+    process->setCgroup(run->cgroup);
+    run->process = process;
+    run->process->setProcessChannelMode(QProcess::MergedChannels);
+    connect(run->process, &QProcess::started, this, [this, run] { reportPriority(run, run->process->processId()); });
+    connect(run->process, &QProcess::readyReadStandardOutput, this, [this, run] { readRun(run); });
+    connect(run->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this, run](int exitCode, QProcess::ExitStatus exitStatus) {
+        readRun(run);
+        QString error = run->lastError;
+        if (error.isEmpty() && (exitCode != 0 || exitStatus != QProcess::NormalExit)) error = "yt-dlp exited with an error";
+        finishRun(run, error);
+    });
+    connect(run->process, &QProcess::errorOccurred, this, [this, run](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) finishRun(run, "Failed to start download: " + run->process->errorString());
+    });
+    run->process->start("yt-dlp", args);
+    QStringList urls;
+    for (int jobId : run->jobIds) {
+        // After a restart only the items still downloading are handed over again
+        if (isDownloading(jobId)) urls << jobs[jobId].url;
+    }
+    run->process->write(urls.join('\n').toUtf8() + '\n');
+    run->process->closeWriteChannel();
+}
+
+// readRun: Splits a spawned run's output into lines.
+void DownloadEngine::readRun(Run *run) {
+    run->buffer += run->process->readAllStandardOutput();
+    int newline;
+    while ((newline = run->buffer.indexOf('\n')) >= 0) {
+        QString line = QString::fromUtf8(run->buffer.left(newline)).trimmed();
+        run->buffer.remove(0, newline + 1);
+        if (!line.isEmpty()) handleRunLine(run, line);
+    }
+}
+
+// handleRunLine: Demultiplexes one line of a spawned run's output.
+void DownloadEngine::handleRunLine(Run *run, const QString &line) {
+    QStringList fields = line.split(' ');
+    QString tag = fields.first();
+    if (tag == "[item]" && fields.size() >= 2) {
+        startItem(run, fields.at(1), line.section(' ', 2));
+    } else if (tag == "[progress]" && fields.size() >= 7) {
+        int jobId = jobFor(run, fields.at(1));
+        // Missing values are printed as "NA" and convert to 0
+        double total = fields.at(3).toDouble();
+        if (total <= 0) total = fields.at(4).toDouble();
+        double eta = fields.at(6) == "NA" ? -1 : fields.at(6).toDouble();
+        if (jobId >= 0) updateProgress(jobId, fields.at(2).toDouble(), total, fields.at(5).toDouble(), eta);
+    } else if (tag == "[postprocess]" && fields.size() >= 2) {
+        int jobId = jobFor(run, fields.at(1));
+        if (jobId >= 0) setState(jobId, DownloadJob::Running, "post-processing");
+    } else if (tag == "[done]" && fields.size() >= 3) {
+        int jobId = jobFor(run, fields.at(1));
+        if (jobId >= 0) fileDone(jobId, line.section(' ', 2));
+    } else if (line.startsWith("ERROR:")) {
+        noteLine(line);
+        handleError(run, line.mid(6).trimmed());
+    } else {
+        noteLine(line);
+        emit logMessage(line);
+    }
+}
+
+// handleError: Attributes an "ERROR:" message to the job it names, or the current one.
+void DownloadEngine::handleError(Run *run, const QString &message) {
+    // Errors look like "[extractor] id: message"
+    static const QRegularExpression idRe("^\\[[^\\]]+\\] ([^:\\s]+):");
+    QRegularExpressionMatch match = idRe.match(message);
+    int jobId = match.hasMatch() ? jobFor(run, match.captured(1)) : -1;
+    if (jobId < 0) jobId = run->currentJob;
+    if (jobId < 0 || jobs[jobId].state != DownloadJob::Running) {
+        run->lastError = message;
+        emit logMessage("ERROR: " + message);
+        return;
+    }
+    jobs[jobId].error = message;
+    setState(jobId, DownloadJob::Failed, "failed");
+}
+
+// fileDone: Records a file yt-dlp finished and moves the job on once it has all of them.
+void DownloadEngine::fileDone(int jobId, const QString &path) {
+    DownloadJob &job = jobs[jobId];
+    if (!isDownloading(jobId)) return;
+    if (!job.plan.isNeeded()) {
+        deliver(jobId, {path});
+        return;
+    }
+    // Two formats of one item may resolve to the same file
+    if (!job.rawFiles.contains(path)) job.rawFiles << path;
+    if (job.rawFiles.size() >= job.plan.files) startPostprocessing(jobId);
+}
+
+// startPostprocessing: Hands a job's raw files to the postprocessing stage.
+void DownloadEngine::startPostprocessing(int jobId) {
+    if (postprocessing.key(jobId, -1) >= 0) return; // Already handed over
+    DownloadJob &job = jobs[jobId];
+    job.percent = 100;
+    postprocessing.insert(postprocessor->submit(job.videoId, job.rawFiles, job.plan, job.priority), jobId);
+    setState(jobId, DownloadJob::Running, "analyzing");
+}
+
+// finishRun: Postprocesses or fails jobs the run left unfinished and frees its slot.
+void DownloadEngine::finishRun(Run *run, const QString &error) {
+    if (!runs.removeOne(run)) return; // Already finished (errorOccurred and finished both fire)
+    if (!run->cgroup.isEmpty()) {
+        // A worker's cgroup outlives the run: only the growth since the run started counts
+        CgroupUsage usage = CgroupTree::usage(run->cgroup);
+        usage.cpuSeconds = (usage.cpuSeconds - run->baseline.cpuSeconds) / run->jobIds.size();
+        usage.ioBytes = (usage.ioBytes - run->baseline.ioBytes) / run->jobIds.size();
+        for (int jobId : run->jobIds) jobs[jobId].usage.add(usage);
+        if (run->process) CgroupTree::shared().remove(run->cgroup);
+    }
+    for (int jobId : run->jobIds) {
+        if (!isDownloading(jobId)) continue;
+        // Fewer files than expected (e.g. a format fell back to one already downloaded)
+        if (!jobs[jobId].rawFiles.isEmpty()) {
+            startPostprocessing(jobId);
+            continue;
+        }
+        jobs[jobId].error = error.isEmpty() ? QString("yt-dlp finished without producing the file") : error;
+        setState(jobId, DownloadJob::Failed, "failed");
+    }
+    if (run->process) run->process->deleteLater();
+    delete run;
+    schedule();
+    if (isIdle()) emit idle();
+}
+
+// jobFor: Finds the job of a run by yt-dlp video id, or by the URL it was queued with.
+int DownloadEngine::jobFor(Run *run, const QString &videoId, const QString &url) const {
+    for (int jobId : run->jobIds) {
+        if (!videoId.isEmpty() && job(jobId).videoId == videoId) return jobId;
+    }
+    // Items probed without an id (e.g. flat entries) are told apart by their URL; a guess is
+    // only safe when a single one of them is left
+    int idless = -1, count = 0;
+    for (int jobId : run->jobIds) {
+        const DownloadJob &candidate = job(jobId);
+        if (!candidate.videoId.isEmpty() || candidate.state != DownloadJob::Running) continue;
+        if (!url.isEmpty() && candidate.url == url) return jobId;
+        idless = jobId;
+        ++count;
+    }
+    return count == 1 ? idless : -1;
+}
+
+// startItem: Makes the job yt-dlp starts the run's current one and learns its video id.
+void DownloadEngine::startItem(Run *run, const QString &videoId, const QString &url) {
+    run->currentJob = jobFor(run, videoId, url);
+    if (run->currentJob < 0) return;
+    // Later lines of the item only carry the id
+    DownloadJob &job = jobs[run->currentJob];
+    if (job.videoId.isEmpty() && !videoId.isEmpty() && videoId != "NA") job.videoId = videoId;
+    setState(run->currentJob, DownloadJob::Running, "downloading");
+}
+
+// updateProgress: Stores progress numbers on a job.
+void DownloadEngine::updateProgress(int jobId, double downloaded, double total, double speed, double eta) {
+    DownloadJob &job = jobs[jobId];
+    // A smaller count means the next file of the job (e.g. its audio) has started
+    qint64 delta = qint64(downloaded) >= job.downloadedBytes ? qint64(downloaded) - job.downloadedBytes : qint64(downloaded);
+    intervalBytes += delta;
+    job.writtenBytes += delta;
+    job.downloadedBytes = qint64(downloaded);
+    job.totalBytes = qint64(total);
+    job.speed = speed;
+    job.eta = int(eta);
+    if (total > 0) job.percent = qBound(0.0, 100.0 * downloaded / total, 100.0);
+    if (job.phase == "starting") job.phase = "downloading";
+    emit jobChanged(jobId);
+}
+
+// setState: Changes a job's state and phase and notifies listeners.
+void DownloadEngine::setState(int jobId, DownloadJob::State state, const QString &phase) {
+    DownloadJob &job = jobs[jobId];
+    job.state = state;
+    job.phase = phase;
+    emit jobChanged(jobId);
+}
+
+// setPressure: Adapts admission to a pressure sample: one run fewer per elevated sample,
+// one more per normal sample, and bulk runs paused while the level is critical.
+void DownloadEngine::setPressure(PressureMonitor::Level level, const QString &reason) {
+    int limit = level == PressureMonitor::Normal ? qMin(maxRuns, pressureLimit + 1) : qMax(1, pressureLimit - 1);
+    if (limit != pressureLimit) {
+        emit logMessage(QString("Load control: at most %1 concurrent download run(s) (%2)").arg(limit).arg(reason));
+        pressureLimit = limit;
+    }
+    if (level != pressureLevel) {
+        pressureLevel = level;
+        int changed = 0;
+        for (Run *run : runs) {
+            if (run->priority.name == "bulk" && run->paused != (level == PressureMonitor::Critical) && pauseRun(run, !run->paused)) {
+                ++changed;
+            }
+        }
+        if (changed > 0) {
+            emit logMessage(QString("%1 %2 bulk download run(s) (%3)")
+                                .arg(level == PressureMonitor::Critical ? "Paused" : "Resumed").arg(changed).arg(reason));
+        }
+    }
+    postprocessor->setPressure(level);
+    schedule();
+}
+
+// pauseRun: Freezes or resumes the process tree serving a run; false if it has none yet.
+// The run's cgroup is frozen when there is one; otherwise the processes get SIGSTOP/SIGCONT.
+bool DownloadEngine::pauseRun(Run *run, bool pause) {
+    if (!CgroupTree::shared().freeze(run->cgroup, pause)) {
+        qint64 pid = run->process ? run->process->processId()
+                                  : run->workerPool ? run->workerPool->processIdFor(run->workerJob) : 0;
+        if (pid <= 0) return false;
+#ifdef Q_OS_UNIX
+        signalProcessTree(pid, pause ? SIGSTOP : SIGCONT);
+#endif
+    }
+    run->paused = pause;
+    for (int jobId : run->jobIds) {
+        if (!isDownloading(jobId)) continue;
+        setState(jobId, DownloadJob::Running, pause ? "paused (system under pressure)" : "downloading");
+    }
+    return true;
+}
+
+// activeRuns: Runs that are not paused.
+int DownloadEngine::activeRuns() const {
+    int active = 0;
+    for (Run *run : runs) if (!run->paused) ++active;
+    return active;
+}
+
+// noteLine: Counts output lines that show a host throttling or failing transfers.
+void DownloadEngine::noteLine(const QString &line) {
+    static const QRegularExpression throttleRe("HTTP Error (403|429|503)|Too Many Requests|timed out|"
+                                               "Connection reset|Got error.*Retrying", QRegularExpression::CaseInsensitiveOption);
+    if (throttleRe.match(line).hasMatch()) ++intervalErrors;
+}
+
+// tuneConcurrency: Feeds the last interval's throughput and errors to the controller.
+void DownloadEngine::tuneConcurrency() {
+    if (runs.isEmpty()) {
+        tuningTimer->stop(); // Nothing to measure; the next run restarts the interval
+        return;
+    }
+    rebalanceBandwidth();
+    double seconds = qMax<qint64>(1, tuningInterval.restart()) / 1000.0;
+    QString decision = controller.update(intervalBytes / seconds, intervalErrors, !queue.isEmpty());
+    intervalBytes = 0;
+    intervalErrors = 0;
+    if (decision.isEmpty()) return;
+    emit logMessage(decision);
+    maxRuns = controller.slotCount();
+    // Pressure only ever lowers the limit; without pressure it follows the controller
+    pressureLimit = pressureLevel == PressureMonitor::Normal ? maxRuns : qMin(pressureLimit, maxRuns);
+    schedule();
+}
+
+// bandwidthShares: Splits the current bandwidth budget across the active runs.
+// Foreground classes weigh more; a run that has settled below its limit for a while
+// (a slow host or a stall) keeps what it uses plus headroom and the rest goes to others.
+QHash<DownloadEngine::Run *, qint64> DownloadEngine::bandwidthShares() const {
+    QHash<Run *, qint64> shares;
+    qint64 budget = bandwidth.budgetAt(QTime::currentTime());
+    QList<Run *> active;
+    QList<double> weights, demands;
+    for (Run *run : runs) {
+        if (run->paused) continue;
+        double speed = 0;
+        if (run->currentJob >= 0 && isDownloading(run->currentJob)) speed = jobs.value(run->currentJob).speed;
+        bool settled = run->age.isValid() && run->age.elapsed() > 10000 && run->rateLimit > 0;
+        active << run;
+        weights << run->priority.bandwidthWeight;
+        demands << (settled && speed > 0 && speed < 0.8 * run->rateLimit ? qMax(speed * 1.25, 16384.0) : -1.0);
+    }
+    QList<qint64> limits = budget > 0 ? BandwidthBudget::split(budget, weights, demands) : QList<qint64>();
+    for (int i = 0; i < active.size(); ++i) shares.insert(active.at(i), budget > 0 ? qMax<qint64>(1024, limits.at(i)) : 0);
+    return shares;
+}
+
+// rebalanceBandwidth: Applies new shares to runs whose limit changed noticeably.
+// Warm workers take the new limit in place; spawned runs are restarted (yt-dlp resumes
+// their .part files), at most every 30 seconds each.
+void DownloadEngine::rebalanceBandwidth() {
+    qint64 budget = bandwidth.budgetAt(QTime::currentTime());
+    if (budget != currentBudget) {
+        currentBudget = budget;
+        emit logMessage(budget > 0 ? QString("Bandwidth budget: %1 KB/s").arg(budget / 1024) : QString("Bandwidth budget: unlimited"));
+    }
+    QHash<Run *, qint64> shares = bandwidthShares();
+    QStringList changes;
+    for (Run *run : runs) {
+        if (run->restarting || !shares.contains(run)) continue;
+        qint64 limit = shares.value(run), old = run->rateLimit;
+        // Changes under 25% are not worth a restart
+        if ((old == 0) == (limit == 0) && qAbs(limit - old) <= old / 4) continue;
+        if (run->workerPool) {
+            QJsonObject message;
+            message["op"] = "limit";
+            message["rate"] = double(limit);
+            if (!run->workerPool->control(run->workerJob, message)) continue;
+            run->rateLimit = limit;
+        } else if (run->process && run->age.elapsed() >= 30000) {
+            run->rateLimit = limit;
+            if (!restartRun(run)) {
+                run->rateLimit = old;
+                continue;
+            }
+        } else {
+            continue;
+        }
+        changes << QString("%1 run of %2 item(s) %3").arg(run->priority.name).arg(run->jobIds.size())
+                       .arg(limit > 0 ? QString("%1 KB/s").arg(limit / 1024) : QString("unlimited"));
+    }
+    if (!changes.isEmpty()) emit logMessage("Bandwidth: " + changes.join("; "));
+}
+
+// restartRun: Restarts a spawned run so a new rate limit takes effect; false if nothing is left to download.
+bool DownloadEngine::restartRun(Run *run) {
+    bool pending = false;
+    for (int jobId : run->jobIds) {
+        if (isDownloading(jobId)) pending = true;
+    }
+    if (!pending) return false;
+    QProcess *old = run->process;
+    run->restarting = true;
+    old->disconnect(this);
+    // The old process must be gone before the new one opens the same .part files
+    connect(old, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, run, old] {
+        old->deleteLater();
+        run->restarting = false;
+        run->buffer.clear();
+        run->currentJob = -1;
+        run->age.start();
+        spawnRun(run);
+    });
+    old->terminate();
+    QTimer::singleShot(3000, old, [old] { old->kill(); });
+    return true;
+}
+
+// isDownloading: True for a running job that has not reached postprocessing or the move yet.
+bool DownloadEngine::isDownloading(int jobId) const {
+    return jobs.value(jobId).state == DownloadJob::Running && postprocessing.key(jobId, -1) < 0 && moving.key(jobId, -1) < 0;
+}
+
+// deliver: Completes a job, first moving its files out of staging when they were written there.
+void DownloadEngine::deliver(int jobId, const QStringList &files) {
+    DownloadJob &job = jobs[jobId];
+    job.percent = 100;
+    if (!job.staged) {
+        job.destination = files.first();
+        job.outputs = files;
+        setState(jobId, DownloadJob::Completed, "done");
+        return;
+    }
+    for (const QString &file : files) {
+        int taskId = mover->move(file, job.targetDir);
+        moving.insert(taskId, jobId);
+        movingFiles.insert(taskId, file);
+    }
+    setState(jobId, DownloadJob::Running, "moving");
+}
+
+// stagingUsage: Bytes in the staging area plus what running downloads are still expected to add.
+qint64 DownloadEngine::stagingUsage() const {
+    qint64 used = 0;
+    const QFileInfoList files = QDir(staging).entryInfoList(QDir::Files | QDir::Hidden);
+    for (const QFileInfo &file : files) used += file.size();
+    for (const DownloadJob &job : jobs) {
+        if (job.staged && isDownloading(job.id) && job.totalBytes > job.downloadedBytes) {
+            used += job.totalBytes - job.downloadedBytes;
+        }
+    }
+    return used;
+}
+
+// diskNeeds: Bytes a job has yet to write, by filesystem root. Downloads count what is left
+// of the estimate (free space already reflects the rest), postprocessing a second copy beside
+// the raw files, and staged jobs the final copy on the save folder's filesystem.
+QHash<QString, qint64> DownloadEngine::diskNeeds(const DownloadJob &job) const {
+    QHash<QString, qint64> needs;
+    if (job.state == DownloadJob::Completed || job.state == DownloadJob::Failed || job.targetDir.isEmpty()) return needs;
+    bool downloading = job.state == DownloadJob::Queued || isDownloading(job.id);
+    QString work = filesystemOf(job.staged ? staging : job.targetDir);
+    // Chapters are a second copy; renditions count as full copies, which overstates audio and proxies
+    int copies = qMax(1, job.plan.renditions.size()) + (job.plan.splitChapters ? 1 : 0);
+    qint64 output = copies * job.sizeEstimate;
+    if (downloading) needs[work] += qMax<qint64>(0, job.sizeEstimate - job.writtenBytes);
+    if (job.plan.isNeeded() && moving.key(job.id, -1) < 0) needs[work] += output;
+    if (job.staged) needs[filesystemOf(job.targetDir)] += output;
+    return needs;
+}
+
+// fitsOnDisk: True when a job's needs fit next to what running jobs have reserved.
+bool DownloadEngine::fitsOnDisk(const DownloadJob &job, const QHash<QString, qint64> &reserved) const {
+    const QHash<QString, qint64> needs = diskNeeds(job);
+    for (auto it = needs.begin(); it != needs.end(); ++it) {
+        QStorageInfo storage(it.key());
+        if (!storage.isValid()) continue; // Unknown filesystem, nothing to check against
+        if (reserved.value(it.key()) + it.value() + diskMargin > storage.bytesAvailable()) return false;
+    }
+    return true;
+}
+
+// filesystemOf: Root of the filesystem holding a folder, cached.
+QString DownloadEngine::filesystemOf(const QString &dir) const {
+    auto cached = filesystems.constFind(dir);
+    if (cached != filesystems.constEnd()) return cached.value();
+    QString root = QStorageInfo(dir).rootPath();
+    if (root.isEmpty()) root = dir;
+    filesystems.insert(dir, root);
+    return root;
+}
+
+// projectedUsage: Disk space the unfinished jobs are expected to need, per filesystem.
+QString DownloadEngine::projectedUsage() const {
+    QHash<QString, qint64> total;
+    int unknown = 0;
+    for (const DownloadJob &job : jobs) {
+        if (job.state == DownloadJob::Completed || job.state == DownloadJob::Failed) continue;
+        if (job.sizeEstimate <= 0) ++unknown;
+        const QHash<QString, qint64> needs = diskNeeds(job);
+        for (auto it = needs.begin(); it != needs.end(); ++it) total[it.key()] += it.value();
+    }
+    QStringList parts;
+    for (auto it = total.begin(); it != total.end(); ++it) {
+        parts << QString("%1 of %2 free on %3").arg(sizeText(it.value(), true), sizeText(QStorageInfo(it.key()).bytesAvailable()), it.key());
+    }
+    if (parts.isEmpty()) return QString();
+    QString text = "Projected disk usage: " + parts.join("; ");
+    if (unknown > 0) text += QString(" (%1 job(s) of unknown size not counted)").arg(unknown);
+    return text;
+}
+
+// runForWorkerJob: Finds the run served by a worker job.
+DownloadEngine::Run *DownloadEngine::runForWorkerJob(WorkerPool *workerPool, int workerJob) const {
+    for (Run *run : runs) {
+        if (run->workerPool == workerPool && run->workerJob == workerJob) return run;
+    }
+    return nullptr;
+}
+
+// poolFor: The warm workers of a priority class, created on first use.
+// Workers cannot be moved back up after serving a lower class without privileges,
+// so each class keeps its own workers.
+WorkerPool *DownloadEngine::poolFor(const ProcessPriority &priority) {
+    WorkerPool *pool = pools.value(priority.name);
+    if (pool) return pool;
+    pool = new WorkerPool(2, priority, this);
+    addPool(priority.name, pool);
+    return pool;
+}
+
+// addPool: Registers the warm workers of a priority class and listens to their jobs.
+void DownloadEngine::addPool(const QString &priorityName, WorkerPool *pool) {
+    pools.insert(priorityName, pool);
+    connect(pool, &WorkerPool::jobEvent, this, [this, pool](int id, const QJsonObject &event) { workerEvent(pool, id, event); });
+    connect(pool, &WorkerPool::jobFinished, this, [this, pool](int id, bool ok, const QString &error) {
+        workerFinished(pool, id, ok, error);
+    });
+    connect(pool, &WorkerPool::jobRejected, this, [this, pool](int id) { workerRejected(pool, id); });
+}
+
+// reportPriority: Reads back the settings of the process serving a run and shows them.
+void DownloadEngine::reportPriority(Run *run, qint64 pid) {
+    if (run->priorityReported || pid <= 0) return;
+    run->priorityReported = true;
+    QString effective = effectivePriority(pid);
+    for (int jobId : run->jobIds) jobs[jobId].effectivePriority = effective;
+    emit logMessage(QString("Running %1 item(s) at %2 priority (%3)").arg(run->jobIds.size()).arg(run->priority.name, effective));
+}
+
+// workerEvent: Applies a warm worker's event to the job it belongs to.
+void DownloadEngine::workerEvent(WorkerPool *workerPool, int workerJob, const QJsonObject &event) {
+    Run *run = runForWorkerJob(workerPool, workerJob);
+    if (!run) return;
+    if (!run->priorityReported) {
+        run->cgroup = workerPool->cgroupFor(workerJob);
+        run->baseline = CgroupTree::usage(run->cgroup);
+    }
+    reportPriority(run, workerPool->processIdFor(workerJob));
+    QString type = event["event"].toString();
+    int jobId = jobFor(run, event["video_id"].toString());
+    if (type == "item_start") {
+        startItem(run, event["video_id"].toString(), event["url"].toString());
+    } else if (type == "progress" && jobId >= 0) {
+        if (event["status"].toString() == "downloading") {
+            double eta = event["eta"].isDouble() ? event["eta"].toDouble() : -1;
+            updateProgress(jobId, event["downloaded_bytes"].toDouble(), event["total_bytes"].toDouble(),
+                           event["speed"].toDouble(), eta);
+        }
+    } else if (type == "postprocess" && jobId >= 0) {
+        if (event["status"].toString() == "started") setState(jobId, DownloadJob::Running, event["postprocessor"].toString());
+    } else if (type == "item_done" && jobId >= 0) {
+        fileDone(jobId, event["filepath"].toString());
+    } else if (type == "log") {
+        QString message = event["message"].toString();
+        noteLine(message);
+        if (message.startsWith("ERROR:")) {
+            handleError(run, message.mid(6).trimmed());
+        } else if (!message.startsWith("[download]")) {
+            emit logMessage(message);
+        }
+    }
+}
+
+// workerFinished: Settles the jobs of a run served by a warm worker.
+void DownloadEngine::workerFinished(WorkerPool *workerPool, int workerJob, bool ok, const QString &error) {
+    Run *run = runForWorkerJob(workerPool, workerJob);
+    if (!run) return;
+    finishRun(run, ok ? QString() : (run->lastError.isEmpty() ? error : run->lastError));
+}
+
+// workerRejected: Re-runs a run the pool could not take in a spawned yt-dlp.
+void DownloadEngine::workerRejected(WorkerPool *workerPool, int workerJob) {
+    Run *run = runForWorkerJob(workerPool, workerJob);
+    if (!run) return;
+    run->workerPool = nullptr;
+    run->workerJob = -1;
+    spawnRun(run);
+}
+
+// postprocessProgress: Shows a postprocessing task's phase on its job.
+void DownloadEngine::postprocessProgress(int taskId, const QString &phase, double percent) {
+    int jobId = postprocessing.value(taskId, -1);
+    if (jobId < 0) return;
+    setState(jobId, DownloadJob::Running, percent > 0 ? QString("%1 %2%").arg(phase).arg(percent, 0, 'f', 0) : phase);
+}
+
+// renditionProgress: Shows the phases of a job's renditions side by side.
+void DownloadEngine::renditionProgress(int taskId, int rendition, const QString &phase, double percent) {
+    int jobId = postprocessing.value(taskId, -1);
+    if (jobId < 0 || rendition >= jobs[jobId].renditions.size()) return;
+    DownloadJob &job = jobs[jobId];
+    job.renditions[rendition].phase = phase;
+    job.renditions[rendition].percent = percent;
+    QStringList phases;
+    for (const DownloadJob::Output &output : job.renditions) {
+        phases << (output.percent > 0 && output.percent < 100 ? QString("%1 %2%").arg(output.label).arg(output.percent, 0, 'f', 0)
+                                                              : QString("%1 %2").arg(output.label, output.phase));
+    }
+    setState(jobId, DownloadJob::Running, phases.join(", "));
+}
+
+// renditionFinished: Records the file or failure of one of a job's renditions.
+void DownloadEngine::renditionFinished(int taskId, int rendition, bool ok, const QString &file, const QString &error) {
+    int jobId = postprocessing.value(taskId, -1);
+    if (jobId < 0 || rendition >= jobs[jobId].renditions.size()) return;
+    DownloadJob::Output &output = jobs[jobId].renditions[rendition];
+    output.file = ok ? file : QString();
+    output.error = error;
+    renditionProgress(taskId, rendition, ok ? "done" : "failed", 100);
+}
+
+// postprocessFinished: Completes or fails the job of a postprocessing task. A job with
+// renditions completes when any of them was written; the others keep their errors.
+void DownloadEngine::postprocessFinished(int taskId, bool ok, const QStringList &files, const QString &error,
+                                         const CgroupUsage &usage) {
+    if (!postprocessing.contains(taskId)) return;
+    int jobId = postprocessing.take(taskId);
+    jobs[jobId].usage.add(usage);
+    if (ok) {
+        deliver(jobId, files);
+    } else {
+        jobs[jobId].error = error;
+        setState(jobId, DownloadJob::Failed, "failed");
+    }
+    schedule(); // Its disk reservation is released
+    if (isIdle()) emit idle();
+}
+
+// moveProgress: Shows how far a job's file has been copied out of staging.
+void DownloadEngine::moveProgress(int taskId, double percent) {
+    int jobId = moving.value(taskId, -1);
+    if (jobId >= 0) setState(jobId, DownloadJob::Running, QString("moving %1%").arg(percent, 0, 'f', 0));
+}
+
+// moveFinished: Completes the job whose files are now all in its folder.
+void DownloadEngine::moveFinished(int taskId, bool ok, const QString &destination, const QString &error) {
+    if (!moving.contains(taskId)) return;
+    int jobId = moving.take(taskId);
+    QString source = movingFiles.take(taskId);
+    DownloadJob &job = jobs[jobId];
+    // The mover works in order, so the whole file comes first and its chapters after it; a
+    // rendition is matched by its staged file, as the one in the folder may have been renamed
+    if (ok) {
+        job.outputs << destination;
+        for (DownloadJob::Output &output : job.renditions) {
+            if (output.file == source) output.file = destination;
+        }
+    } else if (job.error.isEmpty()) job.error = QString("%1 (the file was left in %2)").arg(error, destination);
+    if (moving.key(jobId, -1) >= 0) return; // More of the job's files to move
+    if (job.error.isEmpty()) {
+        job.destination = job.outputs.first();
+        setState(jobId, DownloadJob::Completed, "done");
+    } else {
+        setState(jobId, DownloadJob::Failed, "failed");
+    }
+    schedule(); // The staging space it used is free again
+    if (isIdle()) emit idle();
+}
+
+// MediaFormat: One entry of the "formats" list in probed metadata.
+struct MediaFormat {
+    QString id; // yt-dlp format_id, passed to -f
+    QString ext; // Container extension
+    QString vcodec; // Video codec family ("avc1", "vp9", ...), empty for audio-only
+    QString acodec; // Audio codec family ("aac", "opus", ...), empty for video-only
+    int height = 0; // Video height in pixels
+    double fps = 0; // Frame rate
+    double tbr = 0; // Total bitrate in kbit/s
+    double abr = 0; // Audio bitrate in kbit/s
+    qint64 size = 0; // Size in bytes, 0 when unknown
+    bool sizeIsEstimate = false; // Size is filesize_approx or derived from the bitrate
+
+    bool hasVideo() const { return !vcodec.isEmpty(); }
+    bool hasAudio() const { return !acodec.isEmpty(); }
+};
+
+// codecFamily: Reduces a codec string such as "avc1.640028" to its family name.
+static QString codecFamily(const QString &codec) {
+    QString name = codec.section('.', 0, 0).toLower();
+    if (name.isEmpty() || name == "none") return QString();
+    if (name == "h264" || name == "avc1" || name == "avc3") return "avc1";
+    if (name == "hev1" || name == "hvc1" || name == "h265" || name == "hevc") return "hevc";
+    if (name == "vp09" || name == "vp9") return "vp9";
+    if (name == "vp08" || name == "vp8") return "vp8";
+    if (name == "av01" || name == "av1") return "av1";
+    if (name == "mp4a" || name == "aac") return "aac";
+    if (name == "ac-3" || name == "ac3") return "ac3";
+    if (name == "ec-3" || name == "eac3") return "eac3";
+    return name;
+}
+
+// containerAccepts: True when a codec family can be stream-copied into the container.
+static bool containerAccepts(const QString &container, const QString &codec) {
+    if (codec.isEmpty() || container == "mkv") return true;
+    static const QHash<QString, QStringList> codecs = {
+        {"mp4", {"avc1", "hevc", "av1", "aac", "mp3", "ac3", "eac3"}},
+        {"webm", {"vp8", "vp9", "av1", "opus", "vorbis"}},
+    };
+    return codecs.value(container).contains(codec);
+}
+
+// copiesInto: True when every stream of the format can be stream-copied into the container.
+static bool copiesInto(const MediaFormat &format, const QString &container) {
+    return containerAccepts(container, format.vcodec) && containerAccepts(container, format.acodec);
+}
+
+// FormatChoice: A video/audio pairing, the container it is stored in and the CPU work it needs.
+struct FormatChoice {
+    // CpuCost: What ffmpeg has to do after the download, cheapest first.
+    enum CpuCost { StreamCopy, AudioTranscode, VideoTranscode };
+
+    QString videoId; // Video (or muxed) format ID
+    QString audioId; // Separate audio format ID, empty when the video carries audio
+    QString container; // Output container
+    CpuCost cost = StreamCopy; // Transcoding needed to store the pair in the container
+    double score = 0; // Higher is better
+
+    // args: yt-dlp arguments that download exactly this pairing as separate raw files.
+    // Storing them in the container is left to the postprocessing stage.
+    QStringList args() const {
+        return QStringList() << "-f" << (audioId.isEmpty() ? videoId : videoId + "," + audioId);
+    }
+    // costText: Describes the expected CPU cost for the UI.
+    QString costText() const {
+        switch (cost) {
+            case StreamCopy: return QString("CPU: none (stream copy into %1)").arg(container.toUpper());
+            case AudioTranscode:
+                return QString("CPU: low (audio re-encoded to %1 for %2)").arg(container == "webm" ? "Opus" : "AAC", container.toUpper());
+            case VideoTranscode: return QString("CPU: high (video re-encoded for %1)").arg(container.toUpper());
+        }
+        return QString();
+    }
+};
+
+// chooseContainer: Stores a pairing with the least transcoding under a container policy.
+// "auto" takes the first of MP4, WebM and MKV that accepts both streams, which always
+// succeeds; a fixed container may need the audio or the video re-encoded.
+static FormatChoice chooseContainer(const MediaFormat &video, const MediaFormat *audio, const QString &policy) {
+    FormatChoice choice;
+    choice.videoId = video.id;
+    if (audio) choice.audioId = audio->id;
+    QString acodec = audio ? audio->acodec : video.acodec;
+    QStringList containers = policy == "auto" ? QStringList{"mp4", "webm", "mkv"} : QStringList{policy};
+    for (const QString &container : containers) {
+        choice.container = container;
+        if (containerAccepts(container, video.vcodec) && containerAccepts(container, acodec)) return choice;
+    }
+    choice.cost = containerAccepts(choice.container, video.vcodec) ? FormatChoice::AudioTranscode
+                                                                   : FormatChoice::VideoTranscode;
+    return choice;
+}
+
+// scoreChoice: Rates a pairing: picture and sound quality minus a penalty for transcoding.
+// A video re-encode costs more than any quality gain, so stream-copy pairings always win
+// when one exists; an audio re-encode costs about one resolution step.
+static double scoreChoice(const FormatChoice &choice, const MediaFormat &video, const MediaFormat *audio) {
+    double score = video.height * (video.fps > 30 ? 1.15 : 1.0) + video.tbr / 1000.0;
+    score += (audio ? audio->abr : video.abr) / 10.0;
+    if (choice.cost == FormatChoice::AudioTranscode) score -= 200;
+    if (choice.cost == FormatChoice::VideoTranscode) score -= 100000;
+    if (choice.container == "mp4") score += 1; // Most widely playable at equal quality
+    return score;
+}
+
+// bestAudioFor: Picks the audio format that pairs with a video at the lowest cost and best quality.
+static const MediaFormat *bestAudioFor(const MediaFormat &video, const QList<MediaFormat> &formats,
+                                       const QString &policy, FormatChoice *choice = nullptr) {
+    const MediaFormat *best = nullptr;
+    FormatChoice bestChoice;
+    for (const MediaFormat &audio : formats) {
+        if (audio.hasVideo() || !audio.hasAudio()) continue;
+        FormatChoice candidate = chooseContainer(video, &audio, policy);
+        candidate.score = scoreChoice(candidate, video, &audio);
+        if (!best || candidate.score > bestChoice.score) {
+            best = &audio;
+            bestChoice = candidate;
+        }
+    }
+    if (choice) *choice = bestChoice;
+    return best;
+}
+
+// rankFormats: Scores every video/audio pairing within the height cap, best first.
+static QList<FormatChoice> rankFormats(const QList<MediaFormat> &formats, int maxHeight, const QString &policy) {
+    QList<FormatChoice> ranked;
+    for (const MediaFormat &video : formats) {
+        if (!video.hasVideo() || (maxHeight > 0 && video.height > maxHeight)) continue;
+        FormatChoice choice;
+        if (video.hasAudio()) {
+            choice = chooseContainer(video, nullptr, policy);
+            choice.score = scoreChoice(choice, video, nullptr);
+        } else if (!bestAudioFor(video, formats, policy, &choice)) {
+            continue; // No audio to pair with
+        }
+        ranked << choice;
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const FormatChoice &a, const FormatChoice &b) {
+        return a.score > b.score;
+    });
+    return ranked;
+}
+
+// genericFormatArgs: Remux-first yt-dlp arguments for a height cap when no formats are probed yet.
+// Video and audio are selected as two raw files (","); the postprocessing stage merges
+// them into the first container of the policy that accepts both codecs.
+static QStringList genericFormatArgs(int maxHeight, const QString &policy) {
+    QString cap = QString("[height<=%1]").arg(maxHeight);
+    QString video, audio;
+    if (policy == "mp4") {
+        // Prefer MP4 video with M4A audio so the merge is a plain stream copy
+        video = QString("bv*%1[ext=mp4]/bv*%1/b%1/b").arg(cap);
+        audio = "ba[ext=m4a]/ba/b";
+    } else if (policy == "webm") {
+        video = QString("bv*%1[ext=webm]/bv*%1/b%1/b").arg(cap);
+        audio = "ba[ext=webm]/ba/b";
+    } else {
+        video = QString("bv*%1/b%1/b").arg(cap);
+        audio = "ba/b";
+    }
+    return QStringList() << "-f" << video + "," + audio;
+}
+
+// parseFormats: Extracts the downloadable formats from probed metadata.
+static QList<MediaFormat> parseFormats(const QJsonObject &metadata) {
+    QList<MediaFormat> formats;
+    double duration = metadata["duration"].toDouble();
+    for (const QJsonValue &value : metadata["formats"].toArray()) {
+        QJsonObject json = value.toObject();
+        MediaFormat format;
+        format.id = json["format_id"].toString();
+        format.ext = json["ext"].toString();
+        format.vcodec = codecFamily(json["vcodec"].toString());
+        format.acodec = codecFamily(json["acodec"].toString());
+        if (format.id.isEmpty() || (!format.hasVideo() && !format.hasAudio())) continue; // Storyboards etc.
+        format.height = json["height"].toInt();
+        format.fps = json["fps"].toDouble();
+        format.tbr = json["tbr"].toDouble();
+        format.abr = json["abr"].toDouble();
+        format.size = qint64(json["filesize"].toDouble());
+        if (format.size <= 0) {
+            format.size = qint64(json["filesize_approx"].toDouble());
+            if (format.size <= 0 && format.tbr > 0 && duration > 0) format.size = qint64(format.tbr * 125 * duration);
+            format.sizeIsEstimate = format.size > 0;
+        }
+        formats << format;
+    }
+    return formats;
+}
+
+// estimateSize: Expected download size of an item for a -f value. Exact format ids use their
+// probed size; selectors such as "bv*[height<=720]/b" take the largest matching format, which
+// is what they pick. Items without formats (flat playlist entries) fall back to the top-level
+// size or to the duration at 4 Mbit/s for video and 160 kbit/s for audio.
+static qint64 estimateSize(const QJsonObject &metadata, const QString &formatSpec) {
+    static const QRegularExpression capRe("height<=(\\d+)");
+    QList<MediaFormat> formats = parseFormats(metadata);
+    qint64 total = 0;
+    bool video = false;
+    const QStringList parts = formatSpec.isEmpty() ? QStringList("b") : formatSpec.split(',');
+    for (const QString &part : parts) {
+        bool audio = part.startsWith("ba");
+        video = video || !audio;
+        QRegularExpressionMatch cap = capRe.match(part);
+        int maxHeight = cap.hasMatch() ? cap.captured(1).toInt() : INT_MAX;
+        qint64 size = 0;
+        for (const MediaFormat &format : formats) {
+            if (format.id == part) {
+                size = format.size;
+                break;
+            }
+            bool matches = audio ? format.hasAudio() && !format.hasVideo() : format.hasVideo() && format.height <= maxHeight;
+            if (matches) size = qMax(size, format.size);
+        }
+        total += size;
+    }
+    if (total > 0) return total;
+    total = qint64(metadata["filesize"].toDouble());
+    if (total <= 0) total = qint64(metadata["filesize_approx"].toDouble());
+    if (total <= 0) total = qint64(metadata["duration"].toDouble() * (video ? 500000 : 20000));
+    return total;
+}
+
+// Constructor implementation
+Postprocessor::Postprocessor(QObject *parent) : QObject(parent), network(new QNetworkAccessManager(this)),
+    maxThreads(qMax(1, QThread::idealThreadCount())), coreLimit(maxThreads) {
+    // YTDLP_GUI_SPONSORBLOCK_API points at a mirror or stand-in; "off" keeps offline boxes off the network
+    sponsorApi = qEnvironmentVariable("YTDLP_GUI_SPONSORBLOCK_API", "https://sponsor.ajay.app");
+    if (sponsorApi == "off") sponsorApi.clear();
+    while (sponsorApi.endsWith('/')) sponsorApi.chop(1);
+    QString slack = qEnvironmentVariable("YTDLP_GUI_CUT_SLACK");
+    cutSlack = slack.isEmpty() ? 1.0 : qMax(0.0, slack.toDouble());
+}
+
+// setPressure: Uses half the cores while the machine is under pressure and one task at a time when critical.
+void Postprocessor::setPressure(PressureMonitor::Level level) {
+    coreLimit = level == PressureMonitor::Normal ? maxThreads : level == PressureMonitor::Elevated ? qMax(1, maxThreads / 2) : 1;
+    dispatch();
+}
+
+// submit: Queues the raw files of one download and returns the task id.
+int Postprocessor::submit(const QString &videoId, const QStringList &rawFiles, const PostprocessPlan &plan,
+                          const ProcessPriority &priority) {
+    auto *task = new Task;
+    task->id = nextTaskId++;
+    task->videoId = videoId;
+    task->rawFiles = rawFiles;
+    task->plan = plan;
+    task->priority = priority;
+    task->cgroup = CgroupTree::shared().group(priority, QString("postprocess-%1").arg(task->id));
+    for (int i = 0; i < rawFiles.size(); ++i) {
+        task->vcodecs << QString();
+        task->acodecs << QString();
+    }
+    tasks.insert(task->id, task);
+    // Probes and the API lookup are cheap and run outside the core budget; they start
+    // from the event loop so no result can be reported before the caller has the id
+    task->pendingLookups = rawFiles.size() + (plan.removeSponsors && !videoId.isEmpty() ? 1 : 0);
+    QMetaObject::invokeMethod(this, [this, task] {
+        for (int i = 0; i < task->rawFiles.size(); ++i) probeFile(task, i);
+        if (task->plan.removeSponsors && !task->videoId.isEmpty()) fetchSegments(task);
+    }, Qt::QueuedConnection);
+    return task->id;
+}
+
+// probeFile: Reads the stream codecs and duration of one raw file with ffprobe.
+void Postprocessor::probeFile(Task *task, int file) {
+    auto *ffprobe = new ChildProcess(task->priority, this);
+    ffprobe->setCgroup(task->cgroup);
+    connect(ffprobe, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, task, file, ffprobe] {
+        QJsonObject json = QJsonDocument::fromJson(ffprobe->readAllStandardOutput()).object();
+        for (const QJsonValue &value : json["streams"].toArray()) {
+            QJsonObject stream = value.toObject();
+            if (stream["disposition"].toObject()["attached_pic"].toInt()) continue; // Cover art
+            QString codec = codecFamily(stream["codec_name"].toString());
+            QString type = stream["codec_type"].toString();
+            if (type == "video" && task->vcodecs[file].isEmpty()) {
+                task->vcodecs[file] = codec;
+                if (task->pixelFormat.isEmpty()) {
+                    task->pixelFormat = stream["pix_fmt"].toString();
+                    task->videoProfile = stream["profile"].toString();
+                    task->videoLevel = stream["level"].toInt();
+                    task->videoTimeBase = stream["time_base"].toString();
+                }
+            }
+            if (type == "audio" && task->acodecs[file].isEmpty()) task->acodecs[file] = codec;
+        }
+        task->duration = qMax(task->duration, json["format"].toObject()["duration"].toString().toDouble());
+        // Chapters embedded in the file are relative to it, so a downloaded section's offset is added back
+        if (task->chapters.isEmpty()) {
+            for (const QJsonValue &value : json["chapters"].toArray()) {
+                QJsonObject chapter = value.toObject(), found;
+                found["start_time"] = chapter["start_time"].toString().toDouble() + task->plan.offset;
+                found["end_time"] = chapter["end_time"].toString().toDouble() + task->plan.offset;
+                found["title"] = chapter["tags"].toObject()["title"].toString();
+                task->chapters.append(found);
+            }
+        }
+        ffprobe->deleteLater();
+        lookupDone(task);
+    });
+    connect(ffprobe, &QProcess::errorOccurred, this, [this, task, ffprobe](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) return;
+        ffprobe->deleteLater();
+        lookupDone(task); // The file is reported as having no streams
+    });
+    QStringList args;
+    args << "-v" << "error" << "-of" << "json" << "-show_entries"
+         << "stream=codec_type,codec_name,pix_fmt,profile,level,time_base:stream_disposition=attached_pic:format=duration";
+    if (task->plan.splitChapters && task->plan.chapters.isEmpty()) args << "-show_chapters";
+    ffprobe->start("ffprobe", args << task->rawFiles.at(file));
+}
+
+// fetchSegments: Looks up the video's SponsorBlock segments, in the local store first.
+void Postprocessor::fetchSegments(Task *task) {
+    // Segment times are in the whole video; a downloaded section starts at plan.offset
+    auto addCuts = [task](const SponsorStore::Segments &segments) {
+        for (const auto &segment : segments) {
+            task->cuts << qMakePair(segment.first - task->plan.offset, segment.second - task->plan.offset);
+        }
+    };
+    SponsorStore::Segments segments;
+    if (sponsors.find(task->videoId, &segments) || sponsorApi.isEmpty()) {
+        addCuts(segments);
+        lookupDone(task);
+        return;
+    }
+    QUrl url(sponsorApi + "/api/skipSegments");
+    QUrlQuery query;
+    query.addQueryItem("videoID", task->videoId);
+    query.addQueryItem("categories", QJsonDocument(QJsonArray::fromStringList(SponsorStore::categories())).toJson(QJsonDocument::Compact));
+    url.setQuery(query);
+    QNetworkReply *reply = network->get(QNetworkRequest(url));
+    connect(reply, &QNetworkReply::finished, this, [this, task, reply, addCuts] {
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        SponsorStore::Segments found;
+        if (reply->error() == QNetworkReply::NoError || status == 404) { // 404 means the video has no segments
+            for (const QJsonValue &value : QJsonDocument::fromJson(reply->readAll()).array()) {
+                QJsonArray segment = value.toObject()["segment"].toArray();
+                if (segment.size() == 2) found << qMakePair(segment.at(0).toDouble(), segment.at(1).toDouble());
+            }
+            sponsors.remember(task->videoId, found);
+        } else {
+            emit logMessage(QString("SponsorBlock lookup for %1 failed: %2").arg(task->videoId, reply->errorString()));
+        }
+        addCuts(found);
+        reply->deleteLater();
+        lookupDone(task);
+    });
+}
+
+// probeKeyframes: Reads the video keyframes near the start of every kept range.
+void Postprocessor::probeKeyframes(Task *task, int file) {
+    // Packet flags need no decoding, and only the stretches around the cuts are read
+    QStringList intervals;
+    for (const auto &cut : task->cuts) {
+        if (cut.second <= 0 || cut.second >= task->duration) continue;
+        intervals << QString::number(qMax(0.0, cut.second - cutSlack - 1), 'f', 3) + '%'
+                   + QString::number(cut.second + cutSlack + 20, 'f', 3); // Past the next keyframe of a typical GOP
+    }
+    task->keyframesProbed = true;
+    if (intervals.isEmpty()) {
+        lookupDone(task);
+        return;
+    }
+    auto *ffprobe = new ChildProcess(task->priority, this);
+    ffprobe->setCgroup(task->cgroup);
+    connect(ffprobe, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, task, ffprobe] {
+        // Lines are "pts_time,flags", keyframes flagged "K"
+        for (const QByteArray &line : ffprobe->readAllStandardOutput().split('\n')) {
+            QList<QByteArray> fields = line.split(',');
+            bool ok = false;
+            double time = fields.first().toDouble(&ok);
+            if (ok && fields.value(1).startsWith('K')) task->keyframes << time;
+        }
+        std::sort(task->keyframes.begin(), task->keyframes.end());
+        task->keyframes.erase(std::unique(task->keyframes.begin(), task->keyframes.end()), task->keyframes.end());
+        ffprobe->deleteLater();
+        lookupDone(task);
+    });
+    connect(ffprobe, &QProcess::errorOccurred, this, [this, task, ffprobe](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) return;
+        ffprobe->deleteLater();
+        lookupDone(task); // Cuts fall back to the concat demuxer's own keyframe handling
+    });
+    task->pendingLookups = 1;
+    ffprobe->start("ffprobe", QStringList() << "-v" << "error" << "-select_streams" << "V:0" << "-read_intervals"
+                                            << intervals.join(',') << "-show_entries" << "packet=pts_time,flags"
+                                            << "-of" << "csv=p=0" << task->rawFiles.at(file));
+}
+
+// numberedFileName: The n-th name to try for a file that must not replace another: the path
+// itself, then "Title (2).mp4", "Title (3).mp4" and so on.
+static QString numberedFileName(const QString &path, int n) {
+    if (n == 1) return path;
+    const QFileInfo wanted(path);
+    QString name = wanted.suffix().isEmpty() ? QString("%1 (%2)").arg(wanted.completeBaseName()).arg(n)
+                 : QString("%1 (%2).%3").arg(wanted.completeBaseName()).arg(n).arg(wanted.suffix());
+    return wanted.dir().filePath(name);
+}
+
+// boundaryEncoder: ffmpeg encoder arguments for re-encoded cut boundaries whose stream can be
+// spliced with the copied source, empty when there are none; the quality is high as the pieces
+// are short. The output keeps the first piece's stream parameters, so an H.264 piece gets the
+// source's profile, level and pixel format, and its parameter sets are carried in-band; the
+// concat demuxer turns copied H.264 into Annex B, which repeats the source's SPS/PPS at every
+// keyframe. VP8 and VP9 frames carry their own headers, the profile following the pixel format.
+// HEVC and AV1 are not spliced: copied GOPs would be decoded with the piece's VPS/SPS or
+// sequence header, and HEVC keyframes are often open-GOP CRA frames that reference the frames
+// before the cut. Such cuts start at the keyframe before instead.
+static QStringList boundaryEncoder(const QString &family, const QString &profile, int level, const QString &pixelFormat) {
+    if (pixelFormat.isEmpty()) return {};
+    QStringList args;
+    if (family == "avc1") {
+        static const QHash<QString, QString> profiles = {
+            {"Constrained Baseline", "baseline"}, {"Baseline", "baseline"}, {"Main", "main"}, {"High", "high"},
+            {"High 10", "high10"}, {"High 4:2:2", "high422"}, {"High 4:4:4 Predictive", "high444"},
+        };
+        if (!profiles.contains(profile) || level < 10) return {};
+        args = QStringList{"-c:v", "libx264", "-preset", "veryfast", "-crf", "18", "-flags", "-global_header",
+                           "-profile:v", profiles.value(profile), "-level:v", QString("%1.%2").arg(level / 10).arg(level % 10)};
+    } else if (family == "vp9") {
+        args = QStringList{"-c:v", "libvpx-vp9", "-b:v", "0", "-crf", "24", "-deadline", "good", "-cpu-used", "4"};
+    } else if (family == "vp8") {
+        args = QStringList{"-c:v", "libvpx", "-b:v", "8M", "-crf", "8"};
+    } else {
+        return {};
+    }
+    return args << "-pix_fmt" << pixelFormat;
+}
+
+// lookupDone: Plans the ffmpeg pass once every lookup has answered.
+void Postprocessor::lookupDone(Task *task) {
+    if (--task->pendingLookups > 0) return;
+    // With segments to cut, the keyframes around them decide how each cut is made
+    if (!task->cuts.isEmpty() && !task->keyframesProbed && !task->plan.audioOnly) {
+        for (int file = 0; file < task->rawFiles.size(); ++file) {
+            if (task->vcodecs.at(file).isEmpty()) continue;
+            probeKeyframes(task, file);
+            return;
+        }
+    }
+    QString error;
+    if (!prepare(task, &error)) {
+        finish(task, false, error);
+    } else if (task->args.isEmpty() && task->passes.isEmpty()) {
+        split(task); // The raw file was renamed into place, or the renditions take over
+    } else {
+        waiting << task;
+        emit progress(task->id, "waiting for a free core", 0);
+        dispatch();
+    }
+}
+
+// prepare: Builds the ffmpeg command; returns false with an error if the files are unusable.
+// Video and audio are taken from the raw files that carry them and stream-copied whenever
+// the container accepts the codecs. Cuts keep the complement of the sponsor segments through
+// the concat demuxer's inpoint/outpoint, which is also a stream copy. A copied range of video
+// has to start on a keyframe: it moves to the nearest one within the slack, or the frames
+// before the next keyframe are re-encoded into a piece of their own by an earlier pass when
+// the codec can be spliced (see boundaryEncoder), or else it starts at the keyframe before.
+bool Postprocessor::prepare(Task *task, QString *error) {
+    const PostprocessPlan &plan = task->plan;
+    int videoFile = -1, audioFile = -1;
+    for (int i = 0; i < task->rawFiles.size(); ++i) {
+        if (!plan.audioOnly && videoFile < 0 && !task->vcodecs.at(i).isEmpty()) videoFile = i;
+        // A separately downloaded audio file beats the audio of a muxed one
+        if (!task->acodecs.at(i).isEmpty() && (audioFile < 0 || task->vcodecs.at(i).isEmpty())) audioFile = i;
+    }
+    if (videoFile < 0 && audioFile < 0) {
+        *error = "ffprobe found no usable streams in " + task->rawFiles.join(", ");
+        return false;
+    }
+
+    // Output container and codecs
+    QString container, videoCodec = "copy", audioCodec = "copy", audioBitrate = "192k";
+    if (plan.audioOnly) {
+        container = QFileInfo(task->rawFiles.at(audioFile)).suffix();
+        if (plan.audioCodec == "mp3") {
+            container = "mp3";
+            audioCodec = "libmp3lame";
+            audioBitrate = plan.audioBitrate;
+        }
+    } else {
+        MediaFormat video, audio;
+        if (videoFile >= 0) video.vcodec = task->vcodecs.at(videoFile);
+        if (audioFile >= 0) audio.acodec = task->acodecs.at(audioFile);
+        FormatChoice choice = chooseContainer(video, &audio, plan.container);
+        container = choice.container;
+        if (!containerAccepts(container, audio.acodec)) audioCodec = container == "webm" ? "libopus" : "aac";
+        if (choice.cost == FormatChoice::VideoTranscode) {
+            videoCodec = container == "webm" ? "libvpx-vp9" : "libx264";
+            task->threads = qMax(1, maxThreads / 2);
+        }
+    }
+
+    // Final name: the raw name without yt-dlp's ".f<format_id>" part
+    QFileInfo raw(task->rawFiles.first());
+    QString base = raw.fileName().remove(QRegularExpression("(\\.f[^.]+)?\\.[^.]+$"));
+    task->destination = raw.dir().filePath(base + "." + container);
+    if (task->rawFiles.contains(task->destination)) task->destination = raw.dir().filePath(base + ".processed." + container);
+    // Without a staging area this is the save folder itself, where a file of the same name is kept
+    task->destination = claimName(task->destination);
+
+    // Kept ranges between the merged, clamped sponsor segments; segments outside the file
+    // (e.g. outside a downloaded section) are dropped
+    QList<QPair<double, double>> kept;
+    double length = task->duration;
+    task->cuts.erase(std::remove_if(task->cuts.begin(), task->cuts.end(), [length](const QPair<double, double> &cut) {
+        return cut.second <= 0 || cut.first >= length;
+    }), task->cuts.end());
+    std::sort(task->cuts.begin(), task->cuts.end());
+    double position = 0;
+    for (const auto &cut : task->cuts) {
+        double end = qMin(cut.first, task->duration);
+        if (end > position) kept << qMakePair(position, end);
+        position = qMax(position, cut.second);
+    }
+    if (!task->cuts.isEmpty() && position < task->duration) kept << qMakePair(position, task->duration);
+    bool cutting = !kept.isEmpty(); // Nothing to keep when the duration is unknown
+
+    // Concat entries of the video input; a range whose start moves to a keyframe moves in kept
+    // too, so the audio follows it
+    struct Entry {
+        QString file; // Raw file or re-encoded piece
+        double inpoint = -1; // Start in the file, -1 for its start
+        double outpoint = -1; // End in the file, -1 for its end
+    };
+    QList<Entry> videoEntries;
+    if (cutting && videoFile >= 0) {
+        QString rawVideo = task->rawFiles.at(videoFile);
+        QStringList encoder = boundaryEncoder(task->vcodecs.at(videoFile), task->videoProfile, task->videoLevel, task->pixelFormat);
+        // MP4 pieces also keep the source's timescale, so the spliced timestamps need no rounding
+        QString suffix = QFileInfo(rawVideo).suffix();
+        if (!encoder.isEmpty() && (suffix == "mp4" || suffix == "m4v" || suffix == "mov") && task->videoTimeBase.startsWith("1/")) {
+            encoder << "-video_track_timescale" << task->videoTimeBase.mid(2);
+        }
+        const QList<double> &keyframes = task->keyframes;
+        for (int i = 0; i < kept.size(); ++i) {
+            auto &range = kept[i];
+            double previousEnd = i > 0 ? kept.at(i - 1).second : 0; // A range must not move into the one before
+            // Ranges at the very start, in re-encoded video or without known keyframes need nothing special
+            if (range.first <= 0 || videoCodec != "copy" || keyframes.isEmpty()) {
+                videoEntries << Entry{rawVideo, range.first, range.second};
+                continue;
+            }
+            auto next = std::lower_bound(keyframes.begin(), keyframes.end(), range.first - 0.001);
+            double after = next != keyframes.end() ? *next : -1;
+            double before = next != keyframes.begin() ? *(next - 1) : -1;
+            double nearest = after >= 0 && (before < 0 || after - range.first < range.first - before) ? after : before;
+            if (nearest >= previousEnd && qAbs(nearest - range.first) <= cutSlack && nearest < range.second) {
+                range.first = nearest; // Stream copy from the keyframe; the audio follows
+                videoEntries << Entry{rawVideo, range.first, range.second};
+            } else if (!encoder.isEmpty() && (after < 0 || after > range.first)) {
+                // Re-encode up to the next keyframe (or the whole range if it ends first), copy the rest
+                double copyFrom = after >= 0 && after < range.second ? after : range.second;
+                if (!task->scratch) task->scratch = new QTemporaryDir;
+                QString piece = task->scratch->filePath(QString("boundary%1.%2").arg(task->passes.size())
+                                                             .arg(QFileInfo(rawVideo).suffix()));
+                QStringList pass;
+                pass << "-hide_banner" << "-nostdin" << "-y" << "-v" << "error" << "-nostats" << "-progress" << "pipe:1"
+                     << "-ss" << QString::number(range.first, 'f', 3) << "-i" << rawVideo
+                     << "-t" << QString::number(copyFrom - range.first, 'f', 3) << "-map" << "0:V:0";
+                // A muxed raw file keeps its audio in the piece, so every concat entry has the same streams
+                if (!task->acodecs.at(videoFile).isEmpty()) pass << "-map" << "0:a:0" << "-c:a" << "copy";
+                pass << encoder << "-avoid_negative_ts" << "make_zero" << "-threads" << QString::number(task->threads) << piece;
+                task->passes << pass;
+                videoEntries << Entry{piece};
+                if (copyFrom < range.second) videoEntries << Entry{rawVideo, copyFrom, range.second};
+            } else {
+                videoEntries << Entry{rawVideo, range.first, range.second}; // The concat demuxer starts at the keyframe before
+            }
+        }
+    }
+    task->outputDuration = task->duration;
+    if (cutting) {
+        task->outputDuration = 0;
+        for (const auto &range : kept) task->outputDuration += range.second - range.first;
+    }
+
+    // Chapter pieces of the output: chapter times move into a downloaded section and close up
+    // over removed segments; chapters outside the section or cut away entirely are skipped.
+    // With renditions they are cut from the first one, a remux named like the single output
+    if (plan.splitChapters && (plan.renditions.isEmpty() || plan.renditions.first().kind == Rendition::Remux)) {
+        auto outputTime = [&kept, cutting](double time) {
+            if (!cutting) return time;
+            double output = 0;
+            for (const auto &range : kept) {
+                if (time <= range.first) break;
+                output += qMin(time, range.second) - range.first;
+            }
+            return output;
+        };
+        const QJsonArray chapters = plan.chapters.isEmpty() ? task->chapters : plan.chapters;
+        for (int i = 0; i < chapters.size(); ++i) {
+            QJsonObject chapter = chapters.at(i).toObject();
+            double start = qMax(0.0, chapter["start_time"].toDouble() - plan.offset);
+            double end = chapter["end_time"].toDouble() - plan.offset;
+            if (task->duration > 0) end = qMin(end, task->duration);
+            start = outputTime(start);
+            end = outputTime(end);
+            if (end - start < 0.5) continue;
+            QString title = chapter["title"].toString().replace(QRegularExpression("[/\\\\:*?\"<>|\\x00-\\x1f]"), "_").trimmed();
+            if (title.isEmpty()) title = "Chapter";
+            auto *piece = new Task;
+            piece->id = nextTaskId++;
+            piece->parent = task;
+            piece->priority = task->priority;
+            piece->cgroup = task->cgroup;
+            // A chapter of an earlier download or section of the video keeps its file
+            piece->destination = claimName(raw.dir().filePath(QString("%1 - %2 %3.%4").arg(base, QString("%1").arg(i + 1, 3, 10, QChar('0')),
+                                                                                             title, container)));
+            piece->outputDuration = end - start;
+            piece->phase = "splitting chapters";
+            // Seeking before -i reads only the chapter's range of the file; a copy starts at the keyframe before it
+            piece->args << "-hide_banner" << "-nostdin" << "-n" << "-v" << "error" << "-nostats" << "-progress" << "pipe:1"
+                        << "-ss" << QString::number(start, 'f', 3) << "-i" << task->destination
+                        << "-t" << QString::number(end - start, 'f', 3) << "-map" << "0:V?" << "-map" << "0:a?" << "-c" << "copy"
+                        << "-avoid_negative_ts" << "make_zero" << piece->destination;
+            task->pieces << piece;
+        }
+    }
+
+    // A single file already in the right container only needs a rename
+    bool onlyWantedStreams = !(plan.audioOnly && !task->vcodecs.first().isEmpty());
+    if (task->rawFiles.size() == 1 && !cutting && videoCodec == "copy" && audioCodec == "copy"
+        && raw.suffix() == container && onlyWantedStreams && plan.renditions.isEmpty()) {
+        if (!QDir().rename(raw.filePath(), task->destination)) {
+            *error = "Cannot rename " + raw.filePath();
+            return false;
+        }
+        return true;
+    }
+
+    QStringList args;
+    args << "-hide_banner" << "-nostdin" << "-n" << "-v" << "error" << "-nostats" << "-progress" << "pipe:1";
+    QList<int> inputs; // Raw file of each ffmpeg input
+    for (int file : {videoFile, audioFile}) {
+        if (file < 0 || inputs.contains(file)) continue;
+        if (cutting) {
+            if (!task->scratch) task->scratch = new QTemporaryDir;
+            QString listPath = task->scratch->filePath(QString("keep%1.txt").arg(file));
+            QFile list(listPath);
+            if (!list.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                *error = "Cannot write " + listPath;
+                return false;
+            }
+            QList<Entry> entries = file == videoFile ? videoEntries : QList<Entry>();
+            if (file != videoFile) {
+                for (const auto &range : kept) entries << Entry{task->rawFiles.at(file), range.first, range.second};
+            }
+            QTextStream stream(&list);
+            for (const Entry &entry : entries) {
+                stream << "file '" << QString(entry.file).replace("'", "'\\''") << "'\n";
+                if (entry.inpoint >= 0) stream << "inpoint " << QString::number(entry.inpoint, 'f', 3) << "\n";
+                if (entry.outpoint >= 0) stream << "outpoint " << QString::number(entry.outpoint, 'f', 3) << "\n";
+            }
+            args << "-f" << "concat" << "-safe" << "0" << "-i" << listPath;
+        } else {
+            args << "-i" << task->rawFiles.at(file);
+        }
+        inputs << file;
+    }
+    if (!plan.renditions.isEmpty()) {
+        // Every rendition reads the same inputs, cut lists included, in a pass of its own; the
+        // task itself only runs the boundary passes, if any
+        QList<Task *> chapterPieces = task->pieces;
+        task->pieces.clear();
+        for (int i = 0; i < plan.renditions.size(); ++i) {
+            const Rendition &rendition = plan.renditions.at(i);
+            auto *piece = new Task;
+            piece->id = nextTaskId++;
+            piece->parent = task;
+            piece->rendition = i;
+            piece->priority = task->priority;
+            piece->cgroup = task->cgroup;
+            piece->outputDuration = task->outputDuration;
+            QStringList output = args;
+            QString extension = container, name = base;
+            QString video = QString("%1:V:0").arg(qMax(0, inputs.indexOf(videoFile)));
+            QString audio = QString("%1:a:0").arg(qMax(0, inputs.indexOf(audioFile))); // A missing stream fails the rendition
+            if (rendition.kind == Rendition::Audio) {
+                extension = "mp3";
+                output << "-map" << audio << "-c:a" << "libmp3lame" << "-b:a" << rendition.audioBitrate;
+                piece->phase = "converting to MP3";
+            } else if (rendition.kind == Rendition::Downscale) {
+                // H.264 in MP4 plays everywhere, which is what a proxy is for; never scaled up
+                extension = "mp4";
+                name += QString(" [%1p]").arg(rendition.height);
+                output << "-map" << video;
+                if (audioFile >= 0) output << "-map" << audio;
+                output << "-vf" << QString("scale=-2:'min(%1,ih)'").arg(rendition.height)
+                       << "-c:v" << "libx264" << "-preset" << "veryfast" << "-crf" << "23" << "-pix_fmt" << "yuv420p"
+                       << "-c:a" << (audioFile >= 0 && containerAccepts("mp4", task->acodecs.at(audioFile)) ? "copy" : "aac")
+                       << "-movflags" << "+faststart";
+                piece->threads = qMax(1, maxThreads / 2);
+                piece->phase = QString("scaling to %1p").arg(rendition.height);
+            } else {
+                if (videoFile >= 0) output << "-map" << video;
+                if (audioFile >= 0) output << "-map" << audio;
+                output << "-c:v" << videoCodec << "-c:a" << audioCodec;
+                if (audioCodec != "copy") output << "-b:a" << audioBitrate;
+                piece->threads = task->threads;
+                piece->phase = videoCodec != "copy" ? "re-encoding video" : "remuxing";
+            }
+            // The first remux takes the name claimed for the task, which its chapters are cut from;
+            // the others claim their own, so no file in the folder is overwritten
+            bool primary = i == 0 && rendition.kind == Rendition::Remux;
+            piece->destination = raw.dir().filePath(name + "." + extension);
+            if (task->rawFiles.contains(piece->destination)) piece->destination = raw.dir().filePath(name + ".processed." + extension);
+            piece->destination = primary ? task->destination : claimName(piece->destination);
+            if (cutting) output << "-avoid_negative_ts" << "make_zero";
+            piece->args = output << "-threads" << QString::number(piece->threads) << piece->destination;
+            if (i == 0) {
+                for (Task *chapter : chapterPieces) chapter->parent = piece; // Split from it once it is written
+                piece->pieces = chapterPieces;
+            }
+            task->pieces << piece;
+            task->outputs << QString();
+        }
+        if (plan.renditions.first().kind != Rendition::Remux) claimed.remove(task->destination); // Else the first rendition's
+        task->destination.clear();
+        return true;
+    }
+    if (videoFile >= 0) args << "-map" << QString("%1:V:0").arg(inputs.indexOf(videoFile));
+    if (audioFile >= 0) args << "-map" << QString("%1:a:0").arg(inputs.indexOf(audioFile));
+    args << "-c:v" << videoCodec << "-c:a" << audioCodec;
+    if (audioCodec != "copy") args << "-b:a" << audioBitrate;
+    if (cutting) args << "-avoid_negative_ts" << "make_zero";
+    args << "-threads" << QString::number(task->threads) << task->destination;
+    task->args = args;
+
+    if (videoCodec != "copy") {
+        task->phase = "re-encoding video";
+    } else if (plan.audioCodec == "mp3") {
+        task->phase = "converting to MP3";
+    } else if (cutting) {
+        task->phase = "removing sponsor segments";
+    } else if (audioCodec != "copy") {
+        task->phase = "re-encoding audio";
+    } else {
+        task->phase = inputs.size() > 1 ? "merging" : "remuxing";
+    }
+    return true;
+}
+
+// dispatch: Starts waiting tasks while cores are free.
+void Postprocessor::dispatch() {
+    // A task wider than the free cores still runs when nothing else does
+    while (!waiting.isEmpty() && (usedThreads == 0 || usedThreads + waiting.first()->threads <= coreLimit)) {
+        start(waiting.takeFirst());
+    }
+}
+
+// start: Runs a task's ffmpeg pass.
+void Postprocessor::start(Task *task) {
+    usedThreads += task->threads;
+    runPass(task);
+}
+
+// runPass: Runs a task's next ffmpeg pass, the final one last.
+void Postprocessor::runPass(Task *task) {
+    bool last = task->pass == task->passes.size();
+    if (last && task->args.isEmpty()) {
+        split(task); // The renditions are the final passes
+        return;
+    }
+    if (task->process) task->process->deleteLater(); // The previous pass
+    auto *process = new ChildProcess(task->priority, this);
+    process->setCgroup(task->cgroup);
+    task->process = process;
+    task->buffer.clear();
+    // ffmpeg's -n keeps a file that appeared since prepare (and still exits 0); it is not ours
+    bool fresh = !QFileInfo::exists(task->destination);
+    connect(task->process, &QProcess::readyReadStandardOutput, this, [this, task] { readProgress(task); });
+    connect(task->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this, task, last, fresh](int exitCode, QProcess::ExitStatus exitStatus) {
+        if (exitCode == 0 && exitStatus == QProcess::NormalExit && !last) {
+            ++task->pass;
+            runPass(task);
+        } else if (exitCode == 0 && exitStatus == QProcess::NormalExit && !fresh) {
+            finish(task, false, "Not written, as a file of the same name appeared: " + task->destination);
+        } else if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
+            for (const QString &file : task->rawFiles) QFile::remove(file);
+            split(task);
+        } else {
+            QStringList lines = QString::fromUtf8(task->process->readAllStandardError()).split('\n', Qt::SkipEmptyParts);
+            if (fresh) QFile::remove(task->destination);
+            finish(task, false, "ffmpeg failed: " + (lines.isEmpty() ? QString("exit code %1").arg(exitCode) : lines.last()));
+        }
+    });
+    connect(task->process, &QProcess::errorOccurred, this, [this, task](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) finish(task, false, "Failed to start ffmpeg: " + task->process->errorString());
+    });
+    if (last && task->parent) {
+        // Chapter pieces report through their parent as they finish, renditions on their own
+        if (task->rendition >= 0) emit renditionProgress(task->parent->id, task->rendition, task->phase, 0);
+        task->process->start("ffmpeg", task->args);
+    } else if (last) {
+        emit progress(task->id, task->phase, 0);
+        task->process->start("ffmpeg", task->args);
+    } else {
+        double share = 100.0 * task->pass / task->passes.size();
+        emit progress(task->id, QString("re-encoding cut boundaries (%1/%2)").arg(task->pass + 1).arg(task->passes.size()), share);
+        task->process->start("ffmpeg", task->passes.at(task->pass));
+    }
+}
+
+// split: Queues a task's pieces once its output or cut lists are written, or finishes it.
+void Postprocessor::split(Task *task) {
+    if (task->pieces.isEmpty()) {
+        finish(task, true, QString());
+        return;
+    }
+    // The pieces take their own cores in place of the task's
+    if (task->process) usedThreads -= task->threads;
+    task->threads = 0;
+    bool renditions = task->pieces.first()->rendition >= 0;
+#ifdef Q_OS_LINUX
+    // Start reading the pieces' source into the page cache at once; chapters' disjoint ranges
+    // and renditions' concurrent reads then come from memory instead of each going to the disk
+    for (const QString &file : renditions ? task->rawFiles : QStringList(task->destination)) {
+        QFile source(file);
+        if (source.open(QIODevice::ReadOnly)) ::posix_fadvise(source.handle(), 0, 0, POSIX_FADV_WILLNEED);
+    }
+#endif
+    task->pieceCount = task->piecesLeft = task->pieces.size();
+    // Ahead of other waiting tasks, so the job is done as soon as its pieces are
+    for (int i = task->pieces.size() - 1; i >= 0; --i) {
+        tasks.insert(task->pieces.at(i)->id, task->pieces.at(i));
+        waiting.prepend(task->pieces.at(i));
+        if (renditions) emit renditionProgress(task->id, i, "waiting for a free core", 0);
+    }
+    task->pieces.clear();
+    QString phase = QString("splitting %1 chapters").arg(task->piecesLeft);
+    if (!renditions && task->parent) emit renditionProgress(task->parent->id, task->rendition, phase, 0); // Chapters of a rendition
+    else if (!renditions) emit progress(task->id, phase, 0);
+    dispatch();
+}
+
+// readProgress: Parses ffmpeg's -progress output.
+void Postprocessor::readProgress(Task *task) {
+    task->buffer += task->process->readAllStandardOutput();
+    int newline;
+    while ((newline = task->buffer.indexOf('\n')) >= 0) {
+        QByteArray line = task->buffer.left(newline).trimmed();
+        task->buffer.remove(0, newline + 1);
+        // "out_time_us" is microseconds of output written so far; boundary passes report per pass only
+        if (line.startsWith("out_time_us=") && task->outputDuration > 0 && task->pass == task->passes.size()) {
+            double percent = qBound(0.0, 100.0 * line.mid(12).toDouble() / 1e6 / task->outputDuration, 100.0);
+            if (!task->parent) emit progress(task->id, task->phase, percent);
+            else if (task->rendition >= 0) emit renditionProgress(task->parent->id, task->rendition, task->phase, percent);
+        }
+    }
+}
+
+// finish: Reports a task's result and frees its cores.
+void Postprocessor::finish(Task *task, bool ok, const QString &error) {
+    if (!tasks.remove(task->id)) return; // Already finished (errorOccurred and finished both fire)
+    claimed.remove(task->destination); // Written by now, or given up
+    if (task->process) {
+        usedThreads -= task->threads;
+        task->process->deleteLater();
+    }
+    if (Task *parent = task->parent) {
+        // A failed chapter fails the parent, a failed rendition only itself; the parent
+        // finishes with the last piece
+        if (task->rendition >= 0) {
+            if (ok) {
+                parent->outputs[task->rendition] = task->destination;
+                parent->outputs << task->outputs; // Its chapters, if it was split
+            } else {
+                if (!parent->error.isEmpty()) parent->error += "; ";
+                parent->error += parent->plan.renditions.at(task->rendition).label() + ": " + error;
+            }
+            emit renditionFinished(parent->id, task->rendition, ok, task->destination, error);
+        } else if (ok) {
+            parent->outputs << task->destination;
+        } else if (parent->error.isEmpty()) {
+            parent->error = "Splitting chapters failed: " + error;
+        }
+        if (--parent->piecesLeft > 0) {
+            if (task->rendition < 0) {
+                QString phase = QString("splitting %1 chapters").arg(parent->pieceCount);
+                double percent = 100.0 * (parent->pieceCount - parent->piecesLeft) / parent->pieceCount;
+                if (parent->parent) emit renditionProgress(parent->parent->id, parent->rendition, phase, percent);
+                else emit progress(parent->id, phase, percent);
+            }
+        } else if (task->rendition >= 0) {
+            // The raw files are kept while a rendition is missing
+            if (parent->error.isEmpty()) {
+                for (const QString &file : parent->rawFiles) QFile::remove(file);
+            }
+            finish(parent, parent->outputs.count(QString()) < parent->outputs.size(), parent->error);
+        } else {
+            finish(parent, parent->error.isEmpty(), parent->error);
+        }
+        for (Task *piece : task->pieces) discard(piece); // Chapters of a rendition that failed
+        delete task;
+        dispatch();
+        return;
+    }
+    // ffmpeg has exited, but ffprobe runs may linger after a failed lookup; rmdir then fails harmlessly
+    CgroupUsage usage = CgroupTree::usage(task->cgroup);
+    CgroupTree::shared().remove(task->cgroup);
+    QStringList files = QStringList(task->destination) << task->outputs;
+    files.removeAll(QString()); // Renditions have no file of the task's own, and failed ones none at all
+    emit finished(task->id, ok, files, error, usage);
+    for (Task *piece : task->pieces) discard(piece); // Never queued, as the task failed first
+    delete task->scratch;
+    delete task;
+    dispatch();
+}
+
+// claimName: Reserves the first name for an output that neither exists nor is another task's.
+QString Postprocessor::claimName(const QString &path) {
+    for (int n = 1; n < 1000; ++n) {
+        QString candidate = numberedFileName(path, n);
+        if (!claimed.contains(candidate) && !QFileInfo::exists(candidate)) {
+            claimed.insert(candidate);
+            return candidate;
+        }
+    }
+    return path; // ffmpeg's -n then fails the task instead of replacing the file
+}
+
+// discard: Deletes a piece that never ran, with its own pieces, and frees their names.
+void Postprocessor::discard(Task *task) {
+    for (Task *piece : task->pieces) discard(piece);
+    claimed.remove(task->destination);
+    delete task;
+}
+
+// Destructor: Abandons the copy in progress and waits for its thread.
+FileMover::~FileMover() {
+    if (!thread) return;
+    abort.storeRelaxed(1);
+    thread->wait();
+}
+
+// move: Queues a file to be moved into a folder and returns the task id.
+int FileMover::move(const QString &source, const QString &targetDir) {
+    Task task;
+    task.id = nextTaskId++;
+    task.source = source;
+    task.destination = QDir(targetDir).filePath(QFileInfo(source).fileName());
+    pending.append(task);
+    if (!thread) startNext();
+    return task.id;
+}
+
+// pendingBytes: Size of the files still waiting in staging.
+qint64 FileMover::pendingBytes() const {
+    qint64 total = thread ? QFileInfo(current.source).size() : 0;
+    for (const Task &task : pending) total += QFileInfo(task.source).size();
+    return total;
+}
+
+// startNext: Starts the thread for the next queued move.
+void FileMover::startNext() {
+    if (pending.isEmpty()) return;
+    current = pending.takeFirst();
+    thread = QThread::create([this] { current.error = transfer(current.source, &current.destination, current.id); });
+    connect(thread, &QThread::finished, this, [this] {
+        thread->deleteLater();
+        thread = nullptr;
+        Task done = current;
+        emit finished(done.id, done.error.isEmpty(), done.error.isEmpty() ? done.destination : done.source, done.error);
+        startNext();
+    });
+    thread->start(QThread::LowPriority);
+}
+
+// transfer: Renames or copies a file without replacing one already there; runs on the mover
+// thread, updates the destination to the name used and returns an error message.
+QString FileMover::transfer(const QString &source, QString *destination, int taskId) {
+    // QDir::rename never replaces a file (QFile::rename would silently copy instead): a clash
+    // moves on to the next free name, like "Title (2).mp4", and any other failure means the
+    // file is on another filesystem. A file in the folder is never deleted or overwritten.
+    const QString wanted = *destination;
+    auto place = [destination, &wanted](const QString &file) {
+        for (int n = 1; n < 1000; ++n) {
+            QString candidate = numberedFileName(wanted, n);
+            if (QDir().rename(file, candidate)) {
+                *destination = candidate;
+                return true;
+            }
+            if (!QFileInfo::exists(candidate)) return false;
+        }
+        return false;
+    };
+    if (place(source)) return QString(); // Same filesystem: an atomic rename, nothing to copy
+
+    QFile in(source);
+    QString partial = *destination + ".moving";
+    QFile out(partial);
+    if (!in.open(QIODevice::ReadOnly)) return QString("Cannot read %1: %2").arg(source, in.errorString());
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) return QString("Cannot write %1: %2").arg(partial, out.errorString());
+    qint64 size = in.size(), copied = 0;
+    int shownPercent = -1;
+    auto report = [this, taskId, size, &copied, &shownPercent] {
+        int percent = size > 0 ? int(100 * copied / size) : 100;
+        if (percent == shownPercent) return;
+        shownPercent = percent;
+        QMetaObject::invokeMethod(this, [this, taskId, percent] { emit progress(taskId, percent); }, Qt::QueuedConnection);
+    };
+    bool fallback = true;
+#ifdef Q_OS_LINUX
+    // Chunks keep the copy interruptible and the progress moving
+    fallback = false;
+    while (copied < size && !abort.loadRelaxed()) {
+        ssize_t n = ::copy_file_range(in.handle(), nullptr, out.handle(), nullptr, size_t(qMin<qint64>(size - copied, 64 << 20)), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            // Older kernels, or filesystems that refuse cross-device copies
+            if (copied == 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) fallback = true;
+            else if (n < 0) copied = -1;
+            break;
+        }
+        copied += n;
+        report();
+    }
+#endif
+    if (fallback) {
+        copied = 0;
+        QByteArray buffer(8 << 20, Qt::Uninitialized);
+        while (!abort.loadRelaxed()) {
+            qint64 n = in.read(buffer.data(), buffer.size());
+            if (n <= 0) {
+                if (n < 0) copied = -1;
+                break;
+            }
+            if (out.write(buffer.constData(), n) != n) {
+                copied = -1;
+                break;
+            }
+            copied += n;
+            report();
+        }
+    }
+    QString error;
+    if (abort.loadRelaxed()) error = "Move interrupted";
+    else if (copied != size) error = QString("Copying to %1 failed: %2").arg(partial, out.errorString());
+#ifdef Q_OS_LINUX
+    // The file must be on the target's disk before staging lets go of it
+    if (error.isEmpty() && ::fdatasync(out.handle()) != 0) error = QString("Syncing %1 failed: %2").arg(partial, qt_error_string(errno));
+#endif
+    if (error.isEmpty()) out.setFileTime(in.fileTime(QFileDevice::FileModificationTime), QFileDevice::FileModificationTime);
+    out.close();
+    if (error.isEmpty() && !place(partial)) error = QString("Cannot rename %1 into place").arg(partial);
+    if (!error.isEmpty()) {
+        QFile::remove(partial);
+        return error;
+    }
+    in.close();
+    QFile::remove(source);
+    return QString();
+}
+
+// SearchIndex: Inverted index for filtering large lists as the user types. Titles, channels
+// and ids are split into lowercase words kept in a sorted dictionary of posting lists, so
+// every query word is a prefix range lookup; state and error class change over a row's life
+// and are kept as one interned byte per row instead. A query is a list of words that must
+// all match, each optionally qualified: "title:", "channel:", "id:", "state:" or "error:".
+class SearchIndex {
+public:
+    // Document: Searchable fields of one row.
+    struct Document {
+        QString title; // Display title
+        QString channel; // Uploader or channel name
+        QString id; // Video id
+        QString state; // Lifecycle state, e.g. "failed"
+        QString errorClass; // Kind of failure, e.g. "network"
+    };
+
+    // add: Indexes a row; rows must be added in increasing order.
+    void add(int row, const Document &document);
+    // setStatus: Updates a row's state and error class.
+    void setStatus(int row, const QString &state, const QString &errorClass);
+    // search: Rows matching a query, as a bit per row; an empty query matches every row.
+    QBitArray search(const QString &query) const;
+
+private:
+    // words: Lowercase words of a text.
+    static QStringList words(const QString &text);
+    // matchPrefix: Sets the rows of every word in a field that starts with a prefix.
+    void matchPrefix(QChar field, const QString &prefix, QBitArray &rows) const;
+    // intern: Byte code of a state or error class name.
+    static quint8 intern(QStringList &names, const QString &name);
+
+    QMap<QString, QVector<int>> postings; // Rows by field tag and word, e.g. "t:trailer"
+    QByteArray states; // State code per row
+    QByteArray errors; // Error class code per row
+    QStringList stateNames = {QString()}; // Interned states, code 0 is unknown
+    QStringList errorNames = {QString()}; // Interned error classes, code 0 is none
+    QBitArray present; // Rows that have been added
+};
+
+// add: Indexes a row; rows must be added in increasing order.
+void SearchIndex::add(int row, const Document &document) {
+    const QPair<QChar, QString> fields[] = {{'t', document.title}, {'c', document.channel}, {'i', document.id}};
+    for (const auto &field : fields) {
+        for (const QString &word : words(field.second)) {
+            QVector<int> &rows = postings[QString(field.first) + ':' + word];
+            if (rows.isEmpty() || rows.last() != row) rows << row; // A word twice in one title
+        }
+    }
+    if (row >= present.size()) {
+        present.resize(row + 1);
+        states.resize(row + 1);
+        errors.resize(row + 1);
+    }
+    present.setBit(row);
+    setStatus(row, document.state, document.errorClass);
+}
+
+// setStatus: Updates a row's state and error class.
+void SearchIndex::setStatus(int row, const QString &state, const QString &errorClass) {
+    if (row < 0 || row >= present.size()) return;
+    states[row] = char(intern(stateNames, state.toLower()));
+    errors[row] = char(intern(errorNames, errorClass.toLower()));
+}
+
+// search: Rows matching a query, as a bit per row; an empty query matches every row.
+QBitArray SearchIndex::search(const QString &query) const {
+    QBitArray result = present;
+    for (const QString &term : query.split(' ', Qt::SkipEmptyParts)) {
+        QString field = term.section(':', 0, 0).toLower();
+        QString value = term.contains(':') ? term.section(':', 1) : term;
+        if (!term.contains(':')) field.clear();
+        if (field == "state" || field == "error") {
+            // Per-row codes: find the matching names, then scan one byte per row
+            const QStringList &names = field == "state" ? stateNames : errorNames;
+            const QByteArray &codes = field == "state" ? states : errors;
+            QVector<bool> wanted(names.size());
+            for (int code = 1; code < names.size(); ++code) wanted[code] = names.at(code).startsWith(value.toLower());
+            for (int row = 0; row < codes.size(); ++row) {
+                if (!wanted.at(quint8(codes.at(row)))) result.clearBit(row);
+            }
+            continue;
+        }
+        // Every word of the term has to match, each as a prefix
+        for (const QString &word : words(value)) {
+            QBitArray matches(result.size());
+            if (field.isEmpty() || field == "title") matchPrefix('t', word, matches);
+            if (field.isEmpty() || field == "channel" || field == "uploader") matchPrefix('c', word, matches);
+            if (field.isEmpty() || field == "id") matchPrefix('i', word, matches);
+            result &= matches;
+        }
+    }
+    return result;
+}
+
+// words: Lowercase words of a text.
+QStringList SearchIndex::words(const QString &text) {
+    static const QRegularExpression separators("[^\\w]+");
+    return text.toLower().split(separators, Qt::SkipEmptyParts);
+}
+
+// matchPrefix: Sets the rows of every word in a field that starts with a prefix.
+void SearchIndex::matchPrefix(QChar field, const QString &prefix, QBitArray &rows) const {
+    QString key = QString(field) + ':' + prefix;
+    for (auto it = postings.lowerBound(key); it != postings.constEnd() && it.key().startsWith(key); ++it) {
+        for (int row : it.value()) rows.setBit(row);
+    }
+}
+
+// intern: Byte code of a state or error class name.
+quint8 SearchIndex::intern(QStringList &names, const QString &name) {
+    if (name.isEmpty()) return 0;
+    int code = names.indexOf(name);
+    if (code < 0 && names.size() < 256) {
+        code = names.size();
+        names << name;
+    }
+    return quint8(qMax(0, code));
+}
+
+// SearchService: Keeps a SearchIndex on its own thread, so indexing and per-keystroke
+// queries never block the GUI. Only the newest query is answered; ones typed over
+// before the thread got to them are dropped.
+class SearchService : public QObject {
+    Q_OBJECT
+public:
+    // Constructor: Starts the index thread.
+    explicit SearchService(QObject *parent = nullptr);
+    // Destructor: Stops the index thread.
+    ~SearchService() override;
+    // add: Indexes consecutive rows starting at firstRow.
+    void add(int firstRow, const QVector<SearchIndex::Document> &documents);
+    // setStatus: Updates a row's state and error class.
+    void setStatus(int row, const QString &state, const QString &errorClass);
+    // search: Starts a query; the answer arrives through found().
+    void search(const QString &query);
+
+signals:
+    // found: Emitted with the rows matching the newest query and how long it took.
+    void found(const QString &query, const QBitArray &rows, double milliseconds);
+
+private:
+    QThread thread; // Runs everything that touches the index
+    QObject *context; // Lives on the thread; queued calls run there
+    SearchIndex index; // Only touched on the thread
+    QAtomicInt generation; // Number of the newest query
+};
+
+// Constructor implementation
+SearchService::SearchService(QObject *parent) : QObject(parent), context(new QObject) {
+    context->moveToThread(&thread);
+    connect(&thread, &QThread::finished, context, &QObject::deleteLater);
+    thread.start(QThread::LowPriority);
+}
+
+// Destructor: Stops the index thread.
+SearchService::~SearchService() {
+    thread.quit();
+    thread.wait();
+}
+
+// add: Indexes consecutive rows starting at firstRow.
+void SearchService::add(int firstRow, const QVector<SearchIndex::Document> &documents) {
+    QMetaObject::invokeMethod(context, [this, firstRow, documents] {
+        for (int i = 0; i < documents.size(); ++i) index.add(firstRow + i, documents.at(i));
+    }, Qt::QueuedConnection);
+}
+
+// setStatus: Updates a row's state and error class.
+void SearchService::setStatus(int row, const QString &state, const QString &errorClass) {
+    QMetaObject::invokeMethod(context, [this, row, state, errorClass] { index.setStatus(row, state, errorClass); },
+                              Qt::QueuedConnection);
+}
+
+// search: Starts a query; the answer arrives through found().
+void SearchService::search(const QString &query) {
+    int number = generation.fetchAndAddOrdered(1) + 1;
+    QMetaObject::invokeMethod(context, [this, query, number] {
+        if (generation.loadAcquire() != number) return; // Typed over already
+        QElapsedTimer timer;
+        timer.start();
+        QBitArray rows = index.search(query);
+        emit found(query, rows, timer.nsecsElapsed() / 1e6);
+    }, Qt::QueuedConnection);
+}
+
+// RowFilterProxy: Shows the source rows set in a bit mask, such as a SearchService answer.
+class RowFilterProxy : public QSortFilterProxyModel {
+public:
+    // Constructor: Creates a proxy that shows every row until a mask is set.
+    explicit RowFilterProxy(QObject *parent = nullptr) : QSortFilterProxyModel(parent) {}
+    // setAcceptedRows: Shows only the rows whose bit is set.
+    void setAcceptedRows(const QBitArray &rows) {
+        accepted = rows;
+        filtering = true;
+        invalidateFilter();
+    }
+    // clearFilter: Shows every row again.
+    void clearFilter() {
+        filtering = false;
+        invalidateFilter();
+    }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override {
+        Q_UNUSED(sourceParent);
+        return !filtering || (sourceRow < accepted.size() && accepted.testBit(sourceRow));
+    }
+
+private:
+    QBitArray accepted; // Shown source rows
+    bool filtering = false; // Whether a mask is applied
+};
+
+// thumbnailUrl: The thumbnail of a probed video or playlist entry nearest the shown size: the
+// smallest at least 160 pixels wide, else the widest. YTDLP_GUI_THUMBNAIL_BASE (e.g.
+// "http://127.0.0.1:8000") replaces scheme, host and port, to serve them from a local stand-in.
+static QString thumbnailUrl(const QJsonObject &metadata) {
+    QString url = metadata["thumbnail"].toString();
+    int bestWidth = 0;
+    for (const QJsonValue &value : metadata["thumbnails"].toArray()) {
+        QJsonObject thumbnail = value.toObject();
+        QString candidate = thumbnail["url"].toString();
+        int width = thumbnail["width"].toInt();
+        if (candidate.isEmpty()) continue;
+        bool better = url.isEmpty() || (width >= 160 ? bestWidth < 160 || width < bestWidth : bestWidth < 160 && width > bestWidth);
+        if (better) {
+            url = candidate;
+            bestWidth = width;
+        }
+    }
+    static const QUrl base(qEnvironmentVariable("YTDLP_GUI_THUMBNAIL_BASE"));
+    if (url.isEmpty() || base.isEmpty() || !base.isValid()) return url;
+    QUrl rewritten(url);
+    rewritten.setScheme(base.scheme());
+    rewritten.setHost(base.host());
+    rewritten.setPort(base.port());
+    QString prefix = base.path();
+    if (prefix.endsWith('/')) prefix.chop(1);
+    rewritten.setPath(prefix + rewritten.path());
+    return rewritten.toString();
+}
+
+// ThumbnailCache: Thumbnails for the playlist and jobs views, loaded only when a view asks for
+// the row's image, i.e. for rows on screen. Disk reads, decoding and scaling run on a worker
+// thread (JPEGs are downscaled while decoding), so scrolling never waits for an image. Images
+// live in two tiers: a memory LRU bounded in bytes, shrunk under memory pressure, and a disk
+// cache of the scaled images bounded by YTDLP_GUI_THUMBNAIL_DISK_MAX (default 200M). Downloads
+// run a few at a time, newest request first, so rows scrolled past wait behind visible ones.
+class ThumbnailCache : public QObject {
+    Q_OBJECT
+public:
+    // Constructor: Creates a cache of images scaled to fit size; the disk tier defaults to the cache location.
+    explicit ThumbnailCache(const QSize &size, const QString &directory = QString(), QObject *parent = nullptr);
+    // Destructor: Stops the decode thread.
+    ~ThumbnailCache() override;
+    // image: The thumbnail at url if it is in memory; otherwise starts loading it and returns a null image.
+    QImage image(const QString &url);
+    // setMemoryLimit: Changes how many bytes of images memory keeps, evicting the least recently used at once.
+    void setMemoryLimit(qint64 bytes) { memory.setMaxCost(int(qMin<qint64>(bytes / 1024, INT_MAX))); }
+    // size: Size the images are scaled to fit.
+    QSize size() const { return scaled; }
+
+signals:
+    // ready: Emitted when the thumbnail at url has been loaded into memory.
+    void ready(const QString &url);
+
+private:
+    // lookUp: Loads url from the disk tier, or queues a download; runs on the decode thread.
+    void lookUp(const QString &url);
+    // pump: Starts queued downloads while download slots are free.
+    void pump();
+    // store: Decodes downloaded bytes and writes the scaled image to disk; runs on the decode thread.
+    void store(const QString &url, const QByteArray &bytes);
+    // loaded: Puts a decoded image in memory and tells the views.
+    void loaded(const QString &url, const QImage &image);
+    // decode: Reads an image scaled to fit size.
+    static QImage decode(QIODevice *device, const QSize &size);
+    // diskPath: File of a URL in the disk tier.
+    QString diskPath(const QString &url) const;
+    // trimDisk: Removes the least recently used files while the disk tier is over its limit.
+    void trimDisk();
+
+    QSize scaled; // Size images are scaled to fit
+    QCache<QString, QImage> memory; // Decoded images by URL, cost in KB
+    QSet<QString> loading; // URLs on their way from disk or network
+    QSet<QString> failed; // URLs that could not be loaded, not retried this session
+    QStringList queued; // URLs waiting for a download, newest last
+    int downloads = 0; // Downloads in flight
+    int maxDownloads = 6; // Concurrent downloads, like browsers per host
+    int maxQueued = 256; // Queued downloads kept; older ones are dropped and asked for again when shown
+    QNetworkAccessManager *network; // Thumbnail downloads
+    QString directory; // Disk tier folder
+    qint64 diskLimit; // Most bytes the disk tier keeps
+    int writesSinceTrim = 0; // Files written since the disk tier was last trimmed, decode thread only
+    QThread thread; // Runs disk access and decoding
+    QObject *context; // Lives on the thread; queued calls run there
+};
+
+// Constructor implementation
+ThumbnailCache::ThumbnailCache(const QSize &size, const QString &directory, QObject *parent)
+    : QObject(parent), scaled(size), network(new QNetworkAccessManager(this)), context(new QObject) {
+    this->directory = !directory.isEmpty() ? directory
+        : QString("%1/thumbnails-%2x%3").arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+              .arg(size.width()).arg(size.height());
+    QDir().mkpath(this->directory);
+    QString limit = qEnvironmentVariable("YTDLP_GUI_THUMBNAIL_DISK_MAX");
+    diskLimit = limit.isEmpty() ? qint64(200) << 20 : parseByteSize(limit);
+    setMemoryLimit(qint64(64) << 20);
+    context->moveToThread(&thread);
+    connect(&thread, &QThread::finished, context, &QObject::deleteLater);
+    thread.start(QThread::LowPriority);
+    QMetaObject::invokeMethod(context, [this] { trimDisk(); }, Qt::QueuedConnection);
+}
+
+// Destructor: Stops the decode thread.
+ThumbnailCache::~ThumbnailCache() {
+    thread.quit();
+    thread.wait();
+}
+
+// image: The thumbnail at url if it is in memory; otherwise starts loading it and returns a null image.
+QImage ThumbnailCache::image(const QString &url) {
+    if (url.isEmpty()) return QImage();
+    if (const QImage *hit = memory.object(url)) return *hit; // Also marks it recently used
+    if (failed.contains(url)) return QImage();
+    if (loading.contains(url)) {
+        // Asked for again, so it is on screen now: move it ahead of older requests
+        if (queued.removeOne(url)) queued << url;
+        return QImage();
+    }
+    loading.insert(url);
+    QMetaObject::invokeMethod(context, [this, url] { lookUp(url); }, Qt::QueuedConnection);
+    return QImage();
+}
+
+// lookUp: Loads url from the disk tier, or queues a download; runs on the decode thread.
+void ThumbnailCache::lookUp(const QString &url) {
+    QFile file(diskPath(url));
+    if (file.open(QIODevice::ReadOnly)) {
+        QImage image = decode(&file, scaled);
+        file.close();
+        // The modification time orders the disk tier for trimming
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        if (!image.isNull()) {
+            QMetaObject::invokeMethod(this, [this, url, image] { loaded(url, image); }, Qt::QueuedConnection);
+            return;
+        }
+    }
+    QMetaObject::invokeMethod(this, [this, url] {
+        queued << url;
+        while (queued.size() > maxQueued) loading.remove(queued.takeFirst());
+        pump();
+    }, Qt::QueuedConnection);
+}
+
+// pump: Starts queued downloads while download slots are free.
+void ThumbnailCache::pump() {
+    while (downloads < maxDownloads && !queued.isEmpty()) {
+        QString url = queued.takeLast();
+        ++downloads;
+        QNetworkReply *reply = network->get(QNetworkRequest(QUrl(url)));
+        connect(reply, &QNetworkReply::finished, this, [this, url, reply] {
+            reply->deleteLater();
+            --downloads;
+            if (reply->error() == QNetworkReply::NoError) {
+                QByteArray bytes = reply->readAll();
+                QMetaObject::invokeMethod(context, [this, url, bytes] { store(url, bytes); }, Qt::QueuedConnection);
+            } else {
+                loaded(url, QImage());
+            }
+            pump();
+        });
+    }
+}
+
+// store: Decodes downloaded bytes and writes the scaled image to disk; runs on the decode thread.
+void ThumbnailCache::store(const QString &url, const QByteArray &bytes) {
+    QBuffer buffer;
+    buffer.setData(bytes);
+    buffer.open(QIODevice::ReadOnly);
+    QImage image = decode(&buffer, scaled);
+    if (!image.isNull()) {
+        // Written under a temporary name so a crash never leaves a truncated image
+        QString path = diskPath(url);
+        if (image.save(path + ".part", "JPG", 85)) {
+            QFile::remove(path);
+            QFile::rename(path + ".part", path);
+        }
+        if (++writesSinceTrim >= 100) trimDisk();
+    }
+    QMetaObject::invokeMethod(this, [this, url, image] { loaded(url, image); }, Qt::QueuedConnection);
+}
+
+// loaded: Puts a decoded image in memory and tells the views.
+void ThumbnailCache::loaded(const QString &url, const QImage &image) {
+    loading.remove(url);
+    if (image.isNull()) {
+        failed.insert(url);
+        return;
+    }
+    memory.insert(url, new QImage(image), int(image.sizeInBytes() / 1024) + 1);
+    emit ready(url);
+}
+
+// decode: Reads an image scaled to fit size.
+QImage ThumbnailCache::decode(QIODevice *device, const QSize &size) {
+    QImageReader reader(device);
+    QSize original = reader.size();
+    // Lets the JPEG decoder skip detail instead of decoding full size and scaling down
+    if (original.isValid()) reader.setScaledSize(original.scaled(size, Qt::KeepAspectRatio));
+    QImage image = reader.read();
+    if (!image.isNull() && (image.width() > size.width() || image.height() > size.height())) {
+        image = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
+
+// diskPath: File of a URL in the disk tier.
+QString ThumbnailCache::diskPath(const QString &url) const {
+    return directory + '/' + QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1).toHex() + ".jpg";
+}
+
+// trimDisk: Removes the least recently used files while the disk tier is over its limit.
+void ThumbnailCache::trimDisk() {
+    writesSinceTrim = 0;
+    qint64 total = 0;
+    // Newest first, so everything past the limit is the least recently used
+    for (const QFileInfo &file : QDir(directory).entryInfoList({"*.jpg"}, QDir::Files, QDir::Time)) {
+        total += file.size();
+        if (total > diskLimit) QFile::remove(file.filePath());
+    }
+}
+
+// PlaylistModel: Entries of a probed playlist, for browsing and picking before a download.
+// Rows become visible a page at a time through canFetchMore()/fetchMore(), so a view only
+// builds what is scrolled into reach while entries keep arriving. Each row is a title, a
+// duration and an interned channel id; the checked state is one bit per row, so selecting
+// everything is a single bit fill and one dataChanged().
+class PlaylistModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    // Column: Columns of the view.
+    enum Column { TitleColumn, DurationColumn, ChannelColumn, ColumnCount };
+
+    // Constructor: Creates an empty model.
+    explicit PlaylistModel(QObject *parent = nullptr) : QAbstractTableModel(parent) {}
+    // appendEntries: Adds probed entries, checked; they become rows as the view fetches them.
+    void appendEntries(const QJsonArray &entries);
+    // setAllChecked: Checks or unchecks every entry, including ones not fetched yet.
+    void setAllChecked(bool on);
+    // setRowsChecked: Checks or unchecks the entries whose bit is set, e.g. search matches.
+    void setRowsChecked(const QBitArray &rows, bool on);
+    // checkedRows: Indexes of the checked entries, in playlist order.
+    QList<int> checkedRows() const;
+    // checkedCount: Number of checked entries.
+    int checkedCount() const { return checked.count(true); }
+    // entryCount: Number of entries, fetched or not.
+    int entryCount() const { return rows.size(); }
+    // setThumbnails: Shows entry thumbnails from a cache, loaded as rows are painted.
+    void setThumbnails(ThumbnailCache *cache);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override { return parent.isValid() ? 0 : fetched; }
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override { return parent.isValid() ? 0 : ColumnCount; }
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    bool canFetchMore(const QModelIndex &parent) const override { return !parent.isValid() && fetched < rows.size(); }
+    void fetchMore(const QModelIndex &parent) override;
+
+signals:
+    // checkedCountChanged: Emitted whenever entries are checked or unchecked.
+    void checkedCountChanged(int count);
+
+private:
+    // thumbnailReady: Repaints the row waiting for a thumbnail.
+    void thumbnailReady(const QString &url);
+
+    // Row: One entry.
+    struct Row {
+        QString title; // Display title
+        QString thumbnail; // Thumbnail URL, empty when unknown
+        qint32 duration = 0; // Seconds, 0 when unknown
+        qint32 channel = -1; // Index into channels, -1 when unknown
+    };
+
+    QVector<Row> rows; // All entries, fetched or not
+    QStringList channels; // Interned channel names
+    QHash<QString, int> channelIds; // Index of each interned channel name
+    QBitArray checked; // Checked state per entry
+    int fetched = 0; // Rows exposed to views so far
+    int pageSize = 2000; // Rows added per fetchMore()
+    ThumbnailCache *thumbnails = nullptr; // Source of thumbnails, none when not shown
+    mutable QHash<QString, int> waiting; // Painted rows whose thumbnail is still loading, by URL
+};
+
+// appendEntries: Adds probed entries, checked; they become rows as the view fetches them.
+void PlaylistModel::appendEntries(const QJsonArray &entries) {
+    rows.reserve(rows.size() + entries.size());
+    for (const QJsonValue &value : entries) {
+        QJsonObject entry = value.toObject();
+        Row row;
+        row.title = entry["title"].toString(entry["url"].toString());
+        row.thumbnail = thumbnailUrl(entry);
+        row.duration = qint32(entry["duration"].toDouble());
+        QString channel = entry["channel"].toString(entry["uploader"].toString());
+        if (!channel.isEmpty()) {
+            auto known = channelIds.constFind(channel);
+            if (known == channelIds.constEnd()) {
+                known = channelIds.insert(channel, channels.size());
+                channels << channel;
+            }
+            row.channel = known.value();
+        }
+        rows << row;
+    }
+    int before = checked.size();
+    checked.resize(rows.size());
+    checked.fill(true, before, rows.size());
+    emit checkedCountChanged(checkedCount());
+}
+
+// setAllChecked: Checks or unchecks every entry, including ones not fetched yet.
+void PlaylistModel::setAllChecked(bool on) {
+    checked.fill(on);
+    if (fetched > 0) emit dataChanged(index(0, TitleColumn), index(fetched - 1, TitleColumn), {Qt::CheckStateRole});
+    emit checkedCountChanged(checkedCount());
+}
+
+// setRowsChecked: Checks or unchecks the entries whose bit is set, e.g. search matches.
+void PlaylistModel::setRowsChecked(const QBitArray &rows, bool on) {
+    QBitArray mask = rows;
+    mask.resize(checked.size());
+    if (on) checked |= mask;
+    else checked &= ~mask;
+    if (fetched > 0) emit dataChanged(index(0, TitleColumn), index(fetched - 1, TitleColumn), {Qt::CheckStateRole});
+    emit checkedCountChanged(checkedCount());
+}
+
+// setThumbnails: Shows entry thumbnails from a cache, loaded as rows are painted.
+void PlaylistModel::setThumbnails(ThumbnailCache *cache) {
+    thumbnails = cache;
+    connect(cache, &ThumbnailCache::ready, this, &PlaylistModel::thumbnailReady);
+}
+
+// thumbnailReady: Repaints the row waiting for a thumbnail.
+void PlaylistModel::thumbnailReady(const QString &url) {
+    auto found = waiting.find(url);
+    if (found == waiting.end()) return;
+    QModelIndex cell = index(found.value(), TitleColumn);
+    waiting.erase(found);
+    emit dataChanged(cell, cell, {Qt::DecorationRole});
+}
+
+// checkedRows: Indexes of the checked entries, in playlist order.
+QList<int> PlaylistModel::checkedRows() const {
+    QList<int> result;
+    for (int i = 0; i < checked.size(); ++i) {
+        if (checked.testBit(i)) result << i;
+    }
+    return result;
+}
+
+// data: Title with its check box and thumbnail, duration and channel of a row.
+QVariant PlaylistModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= fetched) return QVariant();
+    const Row &row = rows.at(index.row());
+    if (role == Qt::CheckStateRole && index.column() == TitleColumn) return checked.testBit(index.row()) ? Qt::Checked : Qt::Unchecked;
+    if (role == Qt::DecorationRole && index.column() == TitleColumn) {
+        // Only painted rows ask, so only they are fetched
+        if (!thumbnails || row.thumbnail.isEmpty()) return QVariant();
+        QImage image = thumbnails->image(row.thumbnail);
+        if (image.isNull()) waiting.insert(row.thumbnail, index.row());
+        return image.isNull() ? QVariant() : QVariant(image);
+    }
+    if (role != Qt::DisplayRole) return QVariant();
+    switch (index.column()) {
+    case TitleColumn: return row.title;
+    case DurationColumn: return row.duration > 0 ? durationText(row.duration) : QString();
+    case ChannelColumn: return row.channel >= 0 ? channels.at(row.channel) : QString();
+    }
+    return QVariant();
+}
+
+// headerData: Column titles.
+QVariant PlaylistModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    static const char *const titles[] = {"Title", "Duration", "Channel"};
+    return section >= 0 && section < ColumnCount ? QString(titles[section]) : QVariant();
+}
+
+// flags: Titles carry the check box.
+Qt::ItemFlags PlaylistModel::flags(const QModelIndex &index) const {
+    Qt::ItemFlags result = QAbstractTableModel::flags(index);
+    if (index.column() == TitleColumn) result |= Qt::ItemIsUserCheckable;
+    return result;
+}
+
+// setData: Toggles a row's check box.
+bool PlaylistModel::setData(const QModelIndex &index, const QVariant &value, int role) {
+    if (role != Qt::CheckStateRole || !index.isValid() || index.row() >= fetched) return false;
+    checked.setBit(index.row(), value.toInt() == Qt::Checked);
+    emit dataChanged(index, index, {Qt::CheckStateRole});
+    emit checkedCountChanged(checkedCount());
+    return true;
+}
+
+// fetchMore: Exposes the next page of entries to views.
+void PlaylistModel::fetchMore(const QModelIndex &parent) {
+    if (parent.isValid()) return;
+    int count = qMin(pageSize, rows.size() - fetched);
+    if (count <= 0) return;
+    beginInsertRows(QModelIndex(), fetched, fetched + count - 1);
+    fetched += count;
+    endInsertRows();
+}
+
+// PlaylistDialog: Shows a playlist's entries and lets the user pick which to download.
+class PlaylistDialog : public QDialog {
+    Q_OBJECT
+public:
+    // Constructor: Builds the view over a playlist's probed entries, all checked.
+    PlaylistDialog(const QString &title, const QJsonArray &entries, ThumbnailCache *thumbnails, QWidget *parent = nullptr);
+    // selectedRows: Indexes of the entries to download.
+    QList<int> selectedRows() const { return model->checkedRows(); }
+
+private:
+    PlaylistModel *model; // Entries and their check boxes
+    RowFilterProxy *proxy; // Shows the entries matching the search
+    SearchService *search; // Indexes the entries off the GUI thread
+    QLineEdit *filterEdit; // Search text
+    QBitArray matches; // Entries matching the current search
+};
+
+// Constructor implementation
+PlaylistDialog::PlaylistDialog(const QString &title, const QJsonArray &entries, ThumbnailCache *thumbnails,
+                               QWidget *parent)
+    : QDialog(parent), model(new PlaylistModel(this)), proxy(new RowFilterProxy(this)), search(new SearchService(this)),
+      filterEdit(new QLineEdit(this)) {
+    setWindowTitle("Multiple Videos Detected");
+    resize(720, 480);
+    model->appendEntries(entries);
+    model->setThumbnails(thumbnails);
+    proxy->setSourceModel(model);
+    QVector<SearchIndex::Document> documents;
+    documents.reserve(entries.size());
+    for (const QJsonValue &value : entries) {
+        QJsonObject entry = value.toObject();
+        SearchIndex::Document document;
+        document.title = entry["title"].toString();
+        document.channel = entry["channel"].toString(entry["uploader"].toString());
+        document.id = entry["id"].toString();
+        documents << document;
+    }
+    search->add(0, documents);
+
+    filterEdit->setPlaceholderText("Filter by title, channel:name or id:...");
+    filterEdit->setClearButtonEnabled(true);
+    connect(filterEdit, &QLineEdit::textChanged, this, [this](const QString &text) {
+        if (text.trimmed().isEmpty()) {
+            matches.clear();
+            proxy->clearFilter();
+            return;
+        }
+        // Matches may lie beyond the rows fetched so far
+        while (model->canFetchMore(QModelIndex())) model->fetchMore(QModelIndex());
+        search->search(text);
+    });
+    connect(search, &SearchService::found, this, [this](const QString &query, const QBitArray &rows) {
+        if (query != filterEdit->text()) return; // Answer to text typed over since
+        matches = rows;
+        proxy->setAcceptedRows(rows);
+    });
+
+    auto *view = new QTableView(this);
+    view->setModel(proxy);
+    // Fixed row heights let the view skip measuring rows it does not show
+    view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    view->verticalHeader()->setDefaultSectionSize(thumbnails->size().height() + 4);
+    view->setIconSize(thumbnails->size());
+    view->verticalHeader()->hide();
+    view->horizontalHeader()->setSectionResizeMode(PlaylistModel::TitleColumn, QHeaderView::Stretch);
+    view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    view->setWordWrap(false);
+
+    auto *summary = new QLabel(this);
+    auto showCount = [this, summary, title](int count) {
+        summary->setText(QString("'%1': %2 of %3 videos selected").arg(title).arg(count).arg(model->entryCount()));
+    };
+    connect(model, &PlaylistModel::checkedCountChanged, this, showCount);
+    showCount(model->checkedCount());
+
+    auto *selectAll = new QPushButton("Select All", this);
+    auto *selectNone = new QPushButton("Select None", this);
+    // With a search active, the buttons apply to the matching entries only
+    connect(selectAll, &QPushButton::clicked, this, [this] {
+        if (matches.isEmpty()) model->setAllChecked(true);
+        else model->setRowsChecked(matches, true);
+    });
+    connect(selectNone, &QPushButton::clicked, this, [this] {
+        if (matches.isEmpty()) model->setAllChecked(false);
+        else model->setRowsChecked(matches, false);
+    });
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    buttons->button(QDialogButtonBox::Ok)->setText("Download Selected");
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(model, &PlaylistModel::checkedCountChanged, this, [buttons](int count) {
+        buttons->button(QDialogButtonBox::Ok)->setEnabled(count > 0);
+    });
+
+    auto *buttonRow = new QHBoxLayout;
+    buttonRow->addWidget(selectAll);
+    buttonRow->addWidget(selectNone);
+    buttonRow->addStretch();
+    buttonRow->addWidget(buttons);
+    auto *layout = new QVBoxLayout(this);
+    layout->addWidget(summary);
+    layout->addWidget(filterEdit);
+    layout->addWidget(view);
+    layout->addLayout(buttonRow);
+}
+
+// errorClass: Kind of a job failure for searching with "error:", e.g. "network" or "disk".
+static QString errorClass(const QString &error) {
+    if (error.isEmpty()) return QString();
+    static const QRegularExpression disk("disk space|no space|quota|read-only|permission denied|copying to|syncing|"
+                                         "cannot write|move interrupted", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression postprocess("ffmpeg|ffprobe|postprocess|cannot rename",
+                                                QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression unavailable("unavailable|private|removed|not available|members|copyright|sign in|"
+                                                "http error (403|404|410)", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression network("timed out|timeout|connection|network|resolve|unreachable|ssl|"
+                                            "reset by peer|incomplete|http error (429|5\\d\\d)",
+                                            QRegularExpression::CaseInsensitiveOption);
+    if (disk.match(error).hasMatch()) return "disk";
+    if (postprocess.match(error).hasMatch()) return "postprocess";
+    if (unavailable.match(error).hasMatch()) return "unavailable";
+    if (network.match(error).hasMatch()) return "network";
+    return "other";
+}
+
+// JobsModel: Every job the engine has been given, one row each in enqueue order, showing its
+// state, progress, speed, ETA, size and phase. The engine reports every progress line; instead
+// of a dataChanged() per report, the model only widens a range of changed rows and announces
+// it once per display frame, together with the rows of jobs added since, so hundreds of
+// active jobs cost one repaint of the visible rows per frame.
+class JobsModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    // Column: Columns of the view.
+    enum Column { TitleColumn, StateColumn, ProgressColumn, SpeedColumn, EtaColumn, SizeColumn, PhaseColumn, ColumnCount };
+
+    // Constructor: Follows the engine's job reports.
+    explicit JobsModel(DownloadEngine *engine, QObject *parent = nullptr);
+    // rowOf: Row of a job, -1 when the engine has not reported it.
+    int rowOf(int jobId) const { return rows.value(jobId, -1); }
+    // jobAt: Job id of a row.
+    int jobAt(int row) const { return jobIds.value(row, -1); }
+    // stateName: Display name of a job state.
+    static QString stateName(DownloadJob::State state);
+    // setThumbnails: Shows job thumbnails from a cache, loaded as rows are painted.
+    void setThumbnails(ThumbnailCache *cache);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override { return parent.isValid() ? 0 : shown; }
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override { return parent.isValid() ? 0 : ColumnCount; }
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+signals:
+    // jobAdded: Emitted when a job gets its row; views see the row with the next frame.
+    void jobAdded(int row, int jobId);
+    // stateChanged: Emitted right away when a job's lifecycle state changes.
+    void stateChanged(int row, int jobId);
+    // flushed: Emitted after a frame's changes have been announced to views.
+    void flushed();
+
+private slots:
+    // jobChanged: Records a job report; the row is announced with the next frame.
+    void jobChanged(int jobId);
+    // flush: Announces the rows added and changed since the last frame.
+    void flush();
+    // thumbnailReady: Repaints the row waiting for a thumbnail with the next frame.
+    void thumbnailReady(const QString &url);
+
+private:
+    // markDirty: Adds a shown row to the rows announced with the next frame.
+    void markDirty(int row);
+
+    DownloadEngine *engine; // Owns the jobs shown
+    QVector<int> jobIds; // Job id per row, including rows not announced yet
+    QHash<int, int> rows; // Row per job id
+    QByteArray states; // Last reported state per row
+    int shown = 0; // Rows announced to views
+    int firstDirty = INT_MAX; // First row changed since the last frame
+    int lastDirty = -1; // Last row changed since the last frame, -1 for none
+    QTimer frame; // Single shot, started by the first change of a frame
+    ThumbnailCache *thumbnails = nullptr; // Source of thumbnails, none when not shown
+    mutable QHash<QString, int> waiting; // Painted rows whose thumbnail is still loading, by URL
+};
+
+// Constructor implementation
+JobsModel::JobsModel(DownloadEngine *engine, QObject *parent) : QAbstractTableModel(parent), engine(engine) {
+    frame.setSingleShot(true);
+    frame.setInterval(16); // One display frame at 60 Hz
+    connect(&frame, &QTimer::timeout, this, &JobsModel::flush);
+    connect(engine, &DownloadEngine::jobChanged, this, &JobsModel::jobChanged);
+}
+
+// stateName: Display name of a job state.
+QString JobsModel::stateName(DownloadJob::State state) {
+    static const char *const names[] = {"Queued", "Running", "Completed", "Failed"};
+    return names[state];
+}
+
+// jobChanged: Records a job report; the row is announced with the next frame.
+void JobsModel::jobChanged(int jobId) {
+    const DownloadJob &job = engine->job(jobId);
+    auto known = rows.constFind(jobId);
+    if (known == rows.constEnd()) {
+        int row = jobIds.size();
+        rows.insert(jobId, row);
+        jobIds << jobId;
+        states.append(char(job.state));
+        emit jobAdded(row, jobId);
+    } else {
+        int row = known.value();
+        if (states.at(row) != char(job.state)) {
+            states[row] = char(job.state);
+            emit stateChanged(row, jobId);
+        }
+        markDirty(row);
+    }
+    if (!frame.isActive()) frame.start();
+}
+
+// setThumbnails: Shows job thumbnails from a cache, loaded as rows are painted.
+void JobsModel::setThumbnails(ThumbnailCache *cache) {
+    thumbnails = cache;
+    connect(cache, &ThumbnailCache::ready, this, &JobsModel::thumbnailReady);
+}
+
+// thumbnailReady: Repaints the row waiting for a thumbnail with the next frame.
+void JobsModel::thumbnailReady(const QString &url) {
+    auto found = waiting.find(url);
+    if (found == waiting.end()) return;
+    markDirty(found.value());
+    waiting.erase(found);
+    if (!frame.isActive()) frame.start();
+}
+
+// markDirty: Adds a shown row to the rows announced with the next frame.
+void JobsModel::markDirty(int row) {
+    // Rows not announced yet are read in full when they are
+    if (row >= shown) return;
+    firstDirty = qMin(firstDirty, row);
+    lastDirty = qMax(lastDirty, row);
+}
+
+// flush: Announces the rows added and changed since the last frame.
+void JobsModel::flush() {
+    if (lastDirty >= 0) emit dataChanged(index(firstDirty, 0), index(lastDirty, ColumnCount - 1));
+    firstDirty = INT_MAX;
+    lastDirty = -1;
+    if (jobIds.size() > shown) {
+        beginInsertRows(QModelIndex(), shown, jobIds.size() - 1);
+        shown = jobIds.size();
+        endInsertRows();
+    }
+    emit flushed();
+}
+
+// data: Progress numbers of a row's job, read from the engine when the view paints the row.
+QVariant JobsModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= shown) return QVariant();
+    const DownloadJob &job = engine->job(jobIds.at(index.row()));
+    int column = index.column();
+    if (role == Qt::TextAlignmentRole) {
+        bool numeric = column == ProgressColumn || column == SpeedColumn || column == EtaColumn || column == SizeColumn;
+        return numeric ? QVariant(int(Qt::AlignRight | Qt::AlignVCenter)) : QVariant();
+    }
+    if (role == Qt::DecorationRole && column == TitleColumn) {
+        // Only painted rows ask, so only they are fetched
+        if (!thumbnails || job.thumbnail.isEmpty()) return QVariant();
+        QImage image = thumbnails->image(job.thumbnail);
+        if (image.isNull()) waiting.insert(job.thumbnail, index.row());
+        return image.isNull() ? QVariant() : QVariant(image);
+    }
+    if (role == Qt::ToolTipRole) {
+        if (job.state == DownloadJob::Failed) return job.error;
+        return job.state == DownloadJob::Completed ? job.destination : job.url;
+    }
+    if (role != Qt::DisplayRole) return QVariant();
+    bool running = job.state == DownloadJob::Running;
+    switch (column) {
+    case TitleColumn: return job.title;
+    case StateColumn: return stateName(job.state);
+    case ProgressColumn:
+        if (job.state == DownloadJob::Completed) return QString("100%");
+        return job.percent > 0 ? QString("%1%").arg(job.percent, 0, 'f', 1) : QString();
+    case SpeedColumn: return running && job.speed > 0 ? sizeText(qint64(job.speed)) + "/s" : QString();
+    case EtaColumn: return running && job.eta >= 0 ? durationText(job.eta) : QString();
+    case SizeColumn:
+        if (job.totalBytes > 0) return sizeText(job.totalBytes);
+        return job.sizeEstimate > 0 ? sizeText(job.sizeEstimate, true) : QString();
+    case PhaseColumn: return running || job.state == DownloadJob::Queued ? job.phase : QString();
+    }
+    return QVariant();
+}
+
+// headerData: Column titles.
+QVariant JobsModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    static const char *const titles[] = {"Title", "State", "Progress", "Speed", "ETA", "Size", "Phase"};
+    return section >= 0 && section < ColumnCount ? QString(titles[section]) : QVariant();
+}
 
 // YouTubeDLPWindow: A Qt-based GUI for downloading videos/audio using yt-dlp.
 // Provides input fields for URL and save path, quality selection, and progress display.
@@ -31,50 +5180,136 @@ public:
 private slots:
     // chooseFolder: Opens a dialog to select the save directory.
     void chooseFolder();
-    // startDownload: Initiates the download by running yt-dlp with user inputs.
+    // startDownload: Validates the URLs and probes them for metadata.
     void startDownload();
-    // processError: Handles errors when the yt-dlp process fails to start.
-    void processError(QProcess::ProcessError error);
-    // readProcessOutput: Parses yt-dlp output and displays progress.
-    void readProcessOutput();
-    // processFinished: Handles yt-dlp completion or failure.
-    void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    // urlTextChanged: Cancels stale speculative probes and restarts the debounce timer.
+    void urlTextChanged(const QString &text);
+    // probeSpeculatively: Probes pasted URLs in the background before Download is clicked.
+    void probeSpeculatively();
+    // videoFormatActivated: Pairs a newly picked video format with the audio that transcodes least.
+    void videoFormatActivated(int index);
+    // containerChanged: Relabels the probed formats for the new container and updates the CPU cost.
+    void containerChanged(int index);
+    // chooseChapters: Lets the user pick chapters of the probed video as sections.
+    void chooseChapters();
+    // metadataProbed: Records probed metadata and continues once every URL is answered.
+    void metadataProbed(const QString &url, const QJsonObject &metadata);
+    // metadataProbeFailed: Reports a URL that could not be probed.
+    void metadataProbeFailed(const QString &url, const QString &error);
+    // jobAdded: Indexes a new job row for the filter.
+    void jobAdded(int row, int jobId);
+    // jobStateChanged: Logs results of the request's jobs and updates the filter index.
+    void jobStateChanged(int row, int jobId);
+    // showSummary: Shows the overall progress of the request, once per table frame.
+    void showSummary();
+    // filterJobs: Searches the jobs table for the filter text.
+    void filterJobs(const QString &text);
+    // appendLog: Appends engine output that is not tied to a progress update.
+    void appendLog(const QString &message);
+    // engineIdle: Reports the result once every job of the request has finished.
+    void engineIdle();
 
 private:
+    // launchDownload: Queues a job for every successfully probed URL or playlist entry.
+    void launchDownload();
+    // resetFormatMenus: Fills the quality and subtitle menus with the generic choices.
+    void resetFormatMenus();
+    // populateFormatMenus: Rebuilds the quality and subtitle menus from a URL's probed formats.
+    void populateFormatMenus(const QString &url, const QJsonObject &metadata);
+    // addMp3Choices: Appends the explicit MP3 conversions to the audio menu.
+    void addMp3Choices();
+    // audioOnlyArgs: yt-dlp arguments for the audio-only ("None") video choice.
+    QStringList audioOnlyArgs() const;
+    // menuFormat: Returns the probed format with the given ID, or nullptr.
+    const MediaFormat *menuFormat(const QString &formatId) const;
+    // selectedFormatArgs: yt-dlp format arguments for the current menu selections.
+    QStringList selectedFormatArgs() const;
+    // updateCpuCost: Shows how much transcoding the current selection is expected to need.
+    void updateCpuCost();
+    // finishDownload: Reports the result and re-enables the Download button.
+    void finishDownload(bool ok);
+
     QLineEdit *urlEdit; // URL input field
     QComboBox *videoQualityCombo; // Video quality selector
     QComboBox *audioQualityCombo; // Audio quality selector
     QComboBox *subtitleLangCombo; // Subtitle language selector
+    QComboBox *containerCombo; // Output container policy
+    QLineEdit *sectionsEdit; // Time ranges to download instead of whole videos
+    QPushButton *chaptersButton; // Fills the sections from the probed chapters
+    QComboBox *sectionCutCombo; // Keyframe or precise section cuts
+    QLabel *cpuCostLabel = nullptr; // Expected transcoding cost of the selection
     QLineEdit *savePathEdit; // Save path display
     QPushButton *chooseFolderButton; // Folder selection button
     QPushButton *downloadButton; // Download button
     QCheckBox *sponsorBlockCheck; // SponsorBlock option
-    QTextEdit *progressOutput; // Download progress display
-    QProcess *process = nullptr; // yt-dlp process
-    bool hasProgressLine = false; // Track progress line state
+    QCheckBox *splitChaptersCheck; // Chapter pieces option
+    QCheckBox *alsoMp3Check; // MP3 rendition beside the video
+    QList<QCheckBox *> proxyChecks; // Downscaled renditions beside the video, height in the "height" property
+    QComboBox *priorityCombo; // Priority class of the download's processes
+    QTextEdit *progressOutput; // Log of requests, results and engine messages
+    QLabel *summaryLabel; // Overall progress of the current request
+    JobsModel *jobsModel; // Every job with its progress, updated once per frame
+    ThumbnailCache *thumbnails; // Thumbnails of the jobs table and playlist browser
+    RowFilterProxy *jobsProxy; // Shows the jobs matching the filter
+    SearchService *jobSearch; // Indexes the jobs off the GUI thread
+    QLineEdit *jobFilterEdit; // Jobs table filter text
+    bool jobSearchStale = false; // Jobs were added or changed state since the last search
+    WorkerPool *workerPool; // Warm yt-dlp workers shared by probes and downloads
+    DownloadEngine *engine; // Runs download jobs
+    QList<int> requestJobs; // Engine jobs of the current download request
+    MetadataProber *prober; // Batched metadata probing
+    PressureMonitor *pressure; // Machine stall pressure, drives admission and cache sizes
+    QStringList requestedUrls; // URLs of the current download request, in input order
+    QStringList pendingProbes; // Requested URLs still waiting for metadata
+    QHash<QString, QJsonObject> probedMetadata; // Metadata of successfully probed URLs
+    QTimer *speculativeTimer; // Debounces speculative probing while the URL is edited
+    QStringList speculativeUrls; // URLs probed speculatively for the current text
+    QString formatMenusUrl; // URL whose real formats fill the menus, empty for the generic menus
+    QList<MediaFormat> menuFormats; // Probed formats of formatMenusUrl
+    QJsonObject menuMetadata; // Probed metadata of formatMenusUrl
 };
 
+// plausibleUrls: Returns the http(s) URLs with a host found in whitespace-separated text.
+static QStringList plausibleUrls(const QString &text) {
+    QStringList urls;
+    for (const QString &candidate : text.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts)) {
+        QUrl url(candidate, QUrl::StrictMode);
+        if (url.isValid() && url.scheme().startsWith("http") && url.host().contains('.')) urls << candidate;
+    }
+    urls.removeDuplicates();
+    return urls;
+}
+
 // Constructor implementation
 YouTubeDLPWindow::YouTubeDLPWindow(QWidget *parent) : QWidget(parent) {
     setWindowTitle("YouTube-DLP GUI");
-    resize(600, 300);
+    resize(800, 600);
 
     // Initialize input widgets
     urlEdit = new QLineEdit(this);
-    urlEdit->setPlaceholderText("Paste YouTube link here");
+    urlEdit->setPlaceholderText("Paste YouTube link(s) here, separated by spaces");
     urlEdit->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed); // Dynamic width
 
+    // Quality and subtitle menus start generic and are rebuilt once a URL is probed
     videoQualityCombo = new QComboBox(this);
-    videoQualityCombo->addItems({"4K (2160p)", "1080p", "720p", "480p", "None"}); // Video quality options, None for audio-only
-    videoQualityCombo->setCurrentIndex(0); // Default to highest (4K)
-
+    videoQualityCombo->setSizeAdjustPolicy(QComboBox::AdjustToContents);
     audioQualityCombo = new QComboBox(this);
-    audioQualityCombo->addItems({"320kbps", "256kbps", "128kbps"}); // Audio bitrate options
-    audioQualityCombo->setCurrentIndex(0); // Default to highest (320kbps)
-
+    audioQualityCombo->setSizeAdjustPolicy(QComboBox::AdjustToContents);
     subtitleLangCombo = new QComboBox(this);
-    subtitleLangCombo->addItems({"None", "English (en)", "French (fr)", "Spanish (es)", "German (de)", "Italian (it)", "Portuguese (pt)", "Russian (ru)", "Japanese (ja)", "Chinese (zh)", "Arabic (ar)"}); // Subtitle language options
-    subtitleLangCombo->setCurrentIndex(0); // Default to None
+    containerCombo = new QComboBox(this);
+    containerCombo->addItem("Auto (no re-encode)", "auto"); // First container that takes both streams as-is
+    containerCombo->addItem("MP4", "mp4");
+    containerCombo->addItem("MKV", "mkv");
+    containerCombo->addItem("WebM", "webm");
+    sectionsEdit = new QLineEdit(this);
+    sectionsEdit->setPlaceholderText("Whole video, or ranges such as 1:00-1:30, 2:05:00-2:05:30");
+    chaptersButton = new QPushButton("Chapters...", this);
+    sectionCutCombo = new QComboBox(this);
+    sectionCutCombo->addItem("Cut at keyframes", false); // Stream copy; starts at the keyframe before each range
+    sectionCutCombo->addItem("Cut precisely (re-encode)", true); // yt-dlp --force-keyframes-at-cuts
+    resetFormatMenus();
+    cpuCostLabel = new QLabel(this);
+    updateCpuCost();
 
     savePathEdit = new QLineEdit(this);
     // Set default save path: Videos, Downloads, or home directory
@@ -93,10 +5328,25 @@ YouTubeDLPWindow::YouTubeDLPWindow(QWidget *parent) : QWidget(parent) {
     chooseFolderButton = new QPushButton("Choose Folder", this);
     downloadButton = new QPushButton("Download", this);
     sponsorBlockCheck = new QCheckBox("Remove sponsor segments", this);
+    splitChaptersCheck = new QCheckBox("Split by chapters", this);
+    splitChaptersCheck->setToolTip("Also save every chapter as a file of its own");
+    alsoMp3Check = new QCheckBox("MP3", this);
+    for (int height : {720, 480}) {
+        auto *check = new QCheckBox(QString("%1p MP4").arg(height), this);
+        check->setProperty("height", height);
+        proxyChecks << check;
+    }
+    priorityCombo = new QComboBox(this);
+    priorityCombo->addItem("Interactive", "interactive"); // Normal CPU and I/O priority
+    priorityCombo->addItem("Bulk (background)", "bulk"); // Lower nice and I/O level, optional CPU mask
 
-    // Initialize output display
+    // Initialize output display: a row per job above a log of everything else
     progressOutput = new QTextEdit(this);
     progressOutput->setReadOnly(true); // Always visible, initially blank
+    summaryLabel = new QLabel(this);
+    jobFilterEdit = new QLineEdit(this);
+    jobFilterEdit->setPlaceholderText("Filter jobs by title, channel:, id:, state:failed or error:network");
+    jobFilterEdit->setClearButtonEnabled(true);
 
     // Set up layout with labeled rows
     auto *mainLayout = new QVBoxLayout(this);
@@ -126,17 +5376,108 @@ YouTubeDLPWindow::YouTubeDLPWindow(QWidget *parent) : QWidget(parent) {
     qualityRow->addStretch(); // Fill remaining space
     mainLayout->addLayout(qualityRow);
 
-    // Add SponsorBlock checkbox
-    mainLayout->addWidget(sponsorBlockCheck);
+    // Add container row with the expected transcoding cost
+    auto *containerRow = new QHBoxLayout;
+    containerRow->addWidget(new QLabel("Container:"));
+    containerRow->addWidget(containerCombo);
+    containerRow->addWidget(cpuCostLabel);
+    containerRow->addStretch();
+    mainLayout->addLayout(containerRow);
+
+    // Add sections row: only these ranges are downloaded
+    auto *sectionsRow = new QHBoxLayout;
+    sectionsRow->addWidget(new QLabel("Sections:"));
+    sectionsRow->addWidget(sectionsEdit);
+    sectionsRow->addWidget(chaptersButton);
+    sectionsRow->addWidget(sectionCutCombo);
+    mainLayout->addLayout(sectionsRow);
+
+    // Add SponsorBlock and chapter checkboxes and priority class
+    auto *optionsRow = new QHBoxLayout;
+    optionsRow->addWidget(sponsorBlockCheck);
+    optionsRow->addWidget(splitChaptersCheck);
+    optionsRow->addStretch();
+    optionsRow->addWidget(new QLabel("Priority:"));
+    optionsRow->addWidget(priorityCombo);
+    mainLayout->addLayout(optionsRow);
+
+    // Add renditions row: derived from the same download as the selected video quality
+    auto *renditionsRow = new QHBoxLayout;
+    renditionsRow->addWidget(new QLabel("Also save:"));
+    renditionsRow->addWidget(alsoMp3Check);
+    for (QCheckBox *check : proxyChecks) renditionsRow->addWidget(check);
+    renditionsRow->addStretch();
+    mainLayout->addLayout(renditionsRow);
 
     // Add save path row
     addLabeledWidget("Save Folder:", savePathEdit, chooseFolderButton);
     mainLayout->addWidget(downloadButton);
-    mainLayout->addWidget(progressOutput);
+    mainLayout->addWidget(summaryLabel);
+    mainLayout->addWidget(jobFilterEdit);
+    QTableView *jobsView = new QTableView(this);
+    mainLayout->addWidget(jobsView, 3);
+    mainLayout->addWidget(progressOutput, 1);
 
     // Connect button signals to slots
     connect(chooseFolderButton, &QPushButton::clicked, this, &YouTubeDLPWindow::chooseFolder);
     connect(downloadButton, &QPushButton::clicked, this, &YouTubeDLPWindow::startDownload);
+    connect(videoQualityCombo, QOverload<int>::of(&QComboBox::activated), this, &YouTubeDLPWindow::videoFormatActivated);
+    connect(audioQualityCombo, QOverload<int>::of(&QComboBox::activated), this, &YouTubeDLPWindow::updateCpuCost);
+    connect(containerCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &YouTubeDLPWindow::containerChanged);
+    connect(chaptersButton, &QPushButton::clicked, this, &YouTubeDLPWindow::chooseChapters);
+
+    // Warm workers avoid a Python start per probe and download
+    workerPool = new WorkerPool(2, ProcessPriority::named("interactive"), this);
+    engine = new DownloadEngine(workerPool, this);
+    connect(engine, &DownloadEngine::logMessage, this, &YouTubeDLPWindow::appendLog);
+    connect(engine, &DownloadEngine::idle, this, &YouTubeDLPWindow::engineIdle);
+
+    // Jobs table: the model batches the engine's reports into one update per frame
+    jobsModel = new JobsModel(engine, this);
+    thumbnails = new ThumbnailCache(QSize(64, 36), QString(), this);
+    jobsModel->setThumbnails(thumbnails);
+    jobsProxy = new RowFilterProxy(this);
+    jobsProxy->setDynamicSortFilter(false); // Rows are filtered by search results, not by their data
+    jobsProxy->setSourceModel(jobsModel);
+    jobSearch = new SearchService(this);
+    jobsView->setModel(jobsProxy);
+    // Fixed row heights let the view skip measuring rows it does not show
+    jobsView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    jobsView->verticalHeader()->setDefaultSectionSize(thumbnails->size().height() + 4);
+    jobsView->verticalHeader()->hide();
+    jobsView->setIconSize(thumbnails->size());
+    jobsView->horizontalHeader()->setSectionResizeMode(JobsModel::TitleColumn, QHeaderView::Stretch);
+    jobsView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    jobsView->setWordWrap(false);
+    connect(jobsModel, &JobsModel::jobAdded, this, &YouTubeDLPWindow::jobAdded);
+    connect(jobsModel, &JobsModel::stateChanged, this, &YouTubeDLPWindow::jobStateChanged);
+    connect(jobsModel, &JobsModel::flushed, this, &YouTubeDLPWindow::showSummary);
+    connect(jobFilterEdit, &QLineEdit::textChanged, this, &YouTubeDLPWindow::filterJobs);
+    connect(jobSearch, &SearchService::found, this, [this](const QString &query, const QBitArray &rows) {
+        if (query == jobFilterEdit->text()) jobsProxy->setAcceptedRows(rows); // Else typed over since
+    });
+
+    // Metadata probes for all requested URLs share batched yt-dlp runs
+    prober = new MetadataProber(this);
+    prober->setWorkerPool(workerPool);
+
+    // Probe pasted URLs in the background so Download can start right away
+    speculativeTimer = new QTimer(this);
+    speculativeTimer->setSingleShot(true);
+    speculativeTimer->setInterval(500);
+    connect(urlEdit, &QLineEdit::textChanged, this, &YouTubeDLPWindow::urlTextChanged);
+    connect(speculativeTimer, &QTimer::timeout, this, &YouTubeDLPWindow::probeSpeculatively);
+    connect(prober, &MetadataProber::probed, this, &YouTubeDLPWindow::metadataProbed);
+    connect(prober, &MetadataProber::probeFailed, this, &YouTubeDLPWindow::metadataProbeFailed);
+
+    // Be a good neighbour: admit less work and keep smaller caches while the machine stalls
+    pressure = new PressureMonitor(this);
+    connect(pressure, &PressureMonitor::sampled, engine, &DownloadEngine::setPressure);
+    connect(pressure, &PressureMonitor::memoryPressureChanged, this, [this](bool high) {
+        prober->setCacheLimit(high ? 20 : 200);
+        thumbnails->setMemoryLimit(qint64(high ? 4 : 64) << 20); // The disk tier still has them
+        if (high) appendLog("Memory pressure: metadata cache reduced to 20 entries, thumbnails in memory to 4 MB");
+    });
 }
 
 // chooseFolder: Opens a dialog to select the save directory.
@@ -145,175 +5486,1081 @@ void YouTubeDLPWindow::chooseFolder() {
     if (!folder.isEmpty()) savePathEdit->setText(folder); // Update save path if selected
 }
 
-// startDownload: Initiates the download by running yt-dlp with user inputs.
+// startDownload: Validates the URLs and probes them for metadata.
 void YouTubeDLPWindow::startDownload() {
-    QString url = urlEdit->text();
+    QStringList urls = urlEdit->text().split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
     QString savePath = savePathEdit->text();
     // Check for missing inputs
-    if (url.isEmpty() || savePath.isEmpty()) {
+    if (urls.isEmpty() || savePath.isEmpty()) {
         QMessageBox::critical(this, "Error", "Please provide a URL and save folder.");
         return;
     }
-
-    // Warn if URL scheme is not http or https
-    QUrl urlObj(url);
-    if (urlObj.isValid() && !urlObj.scheme().startsWith("http")) {
-        QMessageBox::StandardButton reply = QMessageBox::warning(
-            this, "Warning",
-            "The URL does not use http or https. This may be unsupported by yt-dlp. Proceed?",
-            QMessageBox::Yes | QMessageBox::No);
-        if (reply == QMessageBox::No) return; // Abort if user cancels
-    }
-
-    // Get metadata with --dump-json to check for playlists or channels
-    QProcess dumpJsonProcess;
-    dumpJsonProcess.start("yt-dlp", QStringList() << "--dump-json" << url);
-    dumpJsonProcess.waitForFinished();
-    if (dumpJsonProcess.exitCode() != 0) {
-        progressOutput->append("---------------------");
-        progressOutput->append("Failed to get metadata: " + dumpJsonProcess.readAllStandardError());
-        progressOutput->append("---------------------");
-        downloadButton->setText("Download");
-        downloadButton->setEnabled(true);
-        return;
-    }
-    QString jsonOutput = dumpJsonProcess.readAllStandardOutput();
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonOutput.toUtf8());
-    if (jsonDoc.isNull()) {
-        progressOutput->append("---------------------");
-        progressOutput->append("Invalid metadata from yt-dlp");
-        progressOutput->append("---------------------");
-        downloadButton->setText("Download");
-        downloadButton->setEnabled(true);
+    urls.removeDuplicates();
+    QString sectionError;
+    parseSections(sectionsEdit->text(), &sectionError);
+    if (!sectionError.isEmpty()) {
+        QMessageBox::critical(this, "Error", sectionError);
         return;
     }
-    QJsonObject json = jsonDoc.object();
-    if (json.contains("entries") && json["entries"].isArray()) {
-        QJsonArray entries = json["entries"].toArray();
-        if (entries.size() > 1) {
-            QString title = json["title"].toString();
+
+    // Warn if any URL scheme is not http or https
+    for (const QString &url : urls) {
+        QUrl urlObj(url);
+        if (urlObj.isValid() && !urlObj.scheme().startsWith("http")) {
             QMessageBox::StandardButton reply = QMessageBox::warning(
-                this, "Multiple Videos Detected",
-                QString("You are attempting to download '%1' with %2 videos. Are you sure?").arg(title).arg(entries.size()),
+                this, "Warning",
+                QString("The URL '%1' does not use http or https. This may be unsupported by yt-dlp. Proceed?").arg(url),
                 QMessageBox::Yes | QMessageBox::No);
-            if (reply == QMessageBox::No) return;
+            if (reply == QMessageBox::No) return; // Abort if user cancels
+            break;
         }
     }
 
-    // Reset progress state and clear output
-    hasProgressLine = false;
+    // Clear the log; the jobs table keeps earlier requests' jobs
     progressOutput->clear();
-    progressOutput->append(QString("Downloading URL: %1").arg(url));
+    summaryLabel->clear();
+    downloadButton->setText("Probing...");
+    downloadButton->setEnabled(false);
+
+    // Get metadata with -J to check for playlists or channels; all URLs share batches
+    requestedUrls = urls;
+    pendingProbes = urls;
+    probedMetadata.clear();
+    prober->probe(urls);
+}
+
+// urlTextChanged: Cancels stale speculative probes and restarts the debounce timer.
+void YouTubeDLPWindow::urlTextChanged(const QString &text) {
+    QStringList current = plausibleUrls(text);
+    if (!formatMenusUrl.isEmpty() && current != QStringList{formatMenusUrl}) resetFormatMenus();
+    for (const QString &url : speculativeUrls) {
+        // Probes of the running download request are still needed
+        if (!current.contains(url) && !pendingProbes.contains(url)) prober->cancel(url);
+    }
+    speculativeUrls.erase(std::remove_if(speculativeUrls.begin(), speculativeUrls.end(),
+                                         [&current](const QString &url) { return !current.contains(url); }),
+                          speculativeUrls.end());
+    speculativeTimer->start();
+}
+
+// probeSpeculatively: Probes pasted URLs in the background before Download is clicked.
+void YouTubeDLPWindow::probeSpeculatively() {
+    QStringList fresh;
+    for (const QString &url : plausibleUrls(urlEdit->text())) {
+        if (!speculativeUrls.contains(url)) fresh << url;
+    }
+    if (fresh.isEmpty()) return;
+    speculativeUrls << fresh;
+    prober->probe(fresh); // Results land in the prober's cache for startDownload()
+}
+
+// metadataProbed: Records probed metadata and continues once every URL is answered.
+void YouTubeDLPWindow::metadataProbed(const QString &url, const QJsonObject &metadata) {
+    // Offer the real formats, unless a download is already being started with the current choices
+    if (!pendingProbes.contains(url) && plausibleUrls(urlEdit->text()) == QStringList{url}
+        && metadata["formats"].isArray() && formatMenusUrl != url) {
+        populateFormatMenus(url, metadata);
+    }
+    if (!pendingProbes.removeOne(url)) return; // Not part of the current request
+    probedMetadata.insert(url, metadata);
+    if (pendingProbes.isEmpty()) launchDownload();
+}
+
+// metadataProbeFailed: Reports a URL that could not be probed.
+void YouTubeDLPWindow::metadataProbeFailed(const QString &url, const QString &error) {
+    if (!pendingProbes.removeOne(url)) return; // Not part of the current request
+    progressOutput->append("---------------------");
+    progressOutput->append(QString("Failed to get metadata for %1: %2").arg(url, error));
+    progressOutput->append("---------------------");
+    if (pendingProbes.isEmpty()) launchDownload();
+}
+
+// chooseChapters: Lets the user pick chapters of the probed video as sections.
+void YouTubeDLPWindow::chooseChapters() {
+    QJsonArray chapters = menuMetadata["chapters"].toArray();
+    if (chapters.isEmpty()) return;
+    QDialog dialog(this);
+    dialog.setWindowTitle("Download Chapters");
+    auto *list = new QListWidget(&dialog);
+    for (const QJsonValue &value : chapters) {
+        QJsonObject chapter = value.toObject();
+        double start = chapter["start_time"].toDouble(), end = chapter["end_time"].toDouble();
+        QString range = QString("%1-%2").arg(timestampText(start), timestampText(end));
+        auto *item = new QListWidgetItem(QString("%1  (%2)").arg(chapter["title"].toString(), range), list);
+        item->setData(Qt::UserRole, range);
+        item->setCheckState(Qt::Unchecked);
+    }
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    auto *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel("Each checked chapter is downloaded as a clip of its own:", &dialog));
+    layout->addWidget(list);
+    layout->addWidget(buttons);
+    if (dialog.exec() != QDialog::Accepted) return;
+    QStringList ranges;
+    for (int i = 0; i < list->count(); ++i) {
+        if (list->item(i)->checkState() == Qt::Checked) ranges << list->item(i)->data(Qt::UserRole).toString();
+    }
+    if (!ranges.isEmpty()) sectionsEdit->setText(ranges.join(", "));
+}
+
+// launchDownload: Queues a job for every successfully probed URL or playlist entry.
+void YouTubeDLPWindow::launchDownload() {
+    QString savePath = savePathEdit->text();
+    QList<QPair<QString, QJsonObject>> items; // URL and metadata of every item to download
+    for (const QString &url : requestedUrls) {
+        if (!probedMetadata.contains(url)) continue; // Probe failed, already reported
+        QJsonObject json = probedMetadata.value(url);
+        if (json.contains("entries") && json["entries"].isArray()) {
+            QJsonArray entries = json["entries"].toArray();
+            QList<int> selected;
+            if (entries.size() > 1) {
+                // Browse and pick entries instead of all-or-nothing
+                PlaylistDialog dialog(json["title"].toString(), entries, thumbnails, this);
+                if (dialog.exec() != QDialog::Accepted) continue;
+                selected = dialog.selectedRows();
+            } else {
+                for (int i = 0; i < entries.size(); ++i) selected << i;
+            }
+            // One job per entry so each video gets its own state and short ones can share a run
+            for (int index : selected) {
+                QJsonObject entry = entries.at(index).toObject();
+                QString entryUrl = entry["webpage_url"].toString(entry["url"].toString());
+                if (!entryUrl.isEmpty()) items.append(qMakePair(entryUrl, entry));
+            }
+        } else {
+            items.append(qMakePair(url, json));
+        }
+        progressOutput->append(QString("Downloading URL: %1").arg(url));
+    }
+    if (items.isEmpty()) {
+        downloadButton->setText("Download");
+        downloadButton->setEnabled(true);
+        return;
+    }
 
     // Indicate download in progress
     downloadButton->setText("Downloading...");
     downloadButton->setEnabled(false);
 
-    // Build yt-dlp command arguments
-    QStringList args;
-    args << "-o" << QString("%1/%(title)s.%(ext)s").arg(savePath); // Output path template
-
-    // Determine format based on quality selections
-    int videoIndex = videoQualityCombo->currentIndex();
-    int audioIndex = audioQualityCombo->currentIndex();
-    QString videoFormat;
-    if (videoIndex < 4) { // Video quality selected (not None)
-        switch (videoIndex) {
-            case 0: videoFormat = "bestvideo[height<=2160]+bestaudio/best"; break; // 4K
-            case 1: videoFormat = "bestvideo[height<=1080]+bestaudio/best"; break; // 1080p
-            case 2: videoFormat = "bestvideo[height<=720]+bestaudio/best"; break; // 720p
-            case 3: videoFormat = "bestvideo[height<=480]+bestaudio/best"; break; // 480p
-        }
-        args << "-f" << videoFormat << "--merge-output-format" << "mp4";
+    // Determine format based on quality selections; probed menus carry exact format IDs.
+    // yt-dlp only downloads; merging, conversion and cutting are planned for the ffmpeg stage
+    QStringList formatArgs;
+    PostprocessPlan plan;
+    bool audioOnly = videoQualityCombo->currentData(Qt::UserRole + 2).toInt() == 0;
+    if (!audioOnly) { // Video quality selected (not None)
+        formatArgs = selectedFormatArgs();
+        plan.container = containerCombo->currentData().toString();
     } else { // None selected, download audio only
-        QString audioQuality = audioQualityCombo->itemText(audioIndex).split("kbps").first();
-        args << "-x" << "--audio-format" << "mp3" << "--audio-quality" << audioQuality;
+        formatArgs = audioOnlyArgs();
+        plan.audioOnly = true;
+        QString choice = audioQualityCombo->currentData().toString();
+        if (choice.startsWith("mp3:")) {
+            plan.audioCodec = "mp3";
+            plan.audioBitrate = choice.mid(4).toLower();
+        }
     }
-
-    // Add subtitle options
-    int subIndex = subtitleLangCombo->currentIndex();
-    if (subIndex > 0) {
-        QString lang = subtitleLangCombo->itemText(subIndex).section("(", 1, 1).section(")", 0, 0);
-        args << "--write-subs" << "--sub-langs" << lang;
+    plan.files = formatArgs.value(1).split(',').size(); // One raw file per comma-separated format
+    plan.removeSponsors = sponsorBlockCheck->isChecked();
+    plan.splitChapters = splitChaptersCheck->isChecked();
+    // Extra outputs come from the one download of the selected video: the video itself first,
+    // then the MP3 and the downscaled copies
+    QList<Rendition> extras;
+    if (alsoMp3Check->isChecked()) {
+        Rendition mp3;
+        mp3.kind = Rendition::Audio;
+        extras << mp3;
     }
+    for (QCheckBox *check : proxyChecks) {
+        if (!check->isChecked()) continue;
+        Rendition proxy;
+        proxy.kind = Rendition::Downscale;
+        proxy.height = check->property("height").toInt();
+        extras << proxy;
+    }
+    if (!audioOnly && !extras.isEmpty()) plan.renditions = QList<Rendition>() << Rendition() << extras;
 
-    // Add SponsorBlock option
-    if (sponsorBlockCheck->isChecked()) {
-        args << "--sponsorblock-remove" << "all";
+    // Build yt-dlp command arguments. With a staging area, media is written and processed
+    // on local scratch and moved to the save folder when done; small subtitle files go there directly
+    QString workPath = engine->stagingDir().isEmpty() ? savePath : engine->stagingDir();
+    QList<QPair<double, double>> sections = parseSections(sectionsEdit->text(), nullptr);
+    // Each section is a job of its own, with its range in the file name
+    QString name = sections.isEmpty() ? QString("%(title)s") : QString("%(title)s [%(section_start)d-%(section_end)d]");
+    QStringList args;
+    if (plan.isNeeded()) {
+        // Raw files are named like yt-dlp's own intermediates; subtitles get the final name
+        args << "-o" << QString("%1/%2.f%(format_id)s.%(ext)s").arg(workPath, name);
+    } else {
+        args << "-o" << QString("%1/%2.%(ext)s").arg(workPath, name); // Output path template
     }
+    args << "-o" << QString("subtitle:%1/%(title)s.%(ext)s").arg(savePath);
+    args << formatArgs;
 
-    args << url;
+    // Add subtitle options
+    QString lang = subtitleLangCombo->currentData().toString();
+    if (!lang.isEmpty()) {
+        args << (subtitleLangCombo->currentData(Qt::UserRole + 1).toBool() ? "--write-auto-subs" : "--write-subs");
+        args << "--sub-langs" << lang;
+    }
 
-    // Start yt-dlp process
-    process = new QProcess(this);
-    connect(process, &QProcess::errorOccurred, this, &YouTubeDLPWindow::processError);
-    connect(process, &QProcess::readyReadStandardOutput, this, &YouTubeDLPWindow::readProcessOutput);
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &YouTubeDLPWindow::processFinished);
-    process->start("yt-dlp", args); // Run yt-dlpWITH arguments
+    // Hand every item to the engine; it batches short items into shared runs
+    requestJobs.clear();
+    ProcessPriority priority = ProcessPriority::named(priorityCombo->currentData().toString());
+    bool precise = sectionCutCombo->currentData().toBool();
+    for (const auto &item : items) {
+        if (sections.isEmpty()) {
+            requestJobs << engine->enqueue(item.first, item.second, args, plan, priority, savePath);
+            continue;
+        }
+        // yt-dlp fetches only the bytes of each range; each comma-separated format is still
+        // a raw file of its own, merged by the postprocessing stage like a whole download
+        double duration = item.second["duration"].toDouble();
+        for (const auto &section : sections) {
+            if (duration > 0 && section.first >= duration) continue; // Past the end of this item
+            QStringList sectionArgs = args;
+            sectionArgs << "--download-sections"
+                        << QString("*%1-%2").arg(QString::number(section.first, 'f', 3), QString::number(section.second, 'f', 3));
+            if (precise) sectionArgs << "--force-keyframes-at-cuts";
+            PostprocessPlan sectionPlan = plan;
+            sectionPlan.offset = section.first;
+            QJsonObject metadata = item.second;
+            metadata["title"] = QString("%1 [%2-%3]").arg(item.second["title"].toString(item.first),
+                                                          timestampText(section.first), timestampText(section.second));
+            requestJobs << engine->enqueue(item.first, metadata, sectionArgs, sectionPlan, priority, savePath);
+        }
+    }
+    QString usage = engine->projectedUsage();
+    if (!usage.isEmpty()) appendLog(usage);
 }
 
-// processError: Handles errors when the yt-dlp process fails to start.
-void YouTubeDLPWindow::processError(QProcess::ProcessError error) {
-    Q_UNUSED(error); // Avoid unused parameter warning
-    progressOutput->append("---------------------");
-    progressOutput->append("Failed to start download: " + process->errorString());
-    progressOutput->append("---------------------");
-    downloadButton->setText("Download");
-    downloadButton->setEnabled(true);
-    process->deleteLater();
-    process = nullptr;
+// jobAdded: Indexes a new job row for the filter.
+void YouTubeDLPWindow::jobAdded(int row, int jobId) {
+    const DownloadJob &job = engine->job(jobId);
+    SearchIndex::Document document;
+    document.title = job.title;
+    document.channel = job.channel;
+    document.id = job.videoId;
+    document.state = JobsModel::stateName(job.state);
+    jobSearch->add(row, {document});
+    jobSearchStale = true;
 }
 
-// readProcessOutput: Parses yt-dlp output and displays progress.
-void YouTubeDLPWindow::readProcessOutput() {
-    QString output = process->readAllStandardOutput();
-    for (const QString &line : output.split('\n', Qt::SkipEmptyParts)) {
-        QString trimmed = line.trimmed();
-        // Extract percentage from [download] lines (e.g., "45.6%")
-        QRegularExpression re("(\\d+\\.\\d+)%");
-        QRegularExpressionMatch match = re.match(trimmed);
-        if (match.hasMatch()) {
-            QString progressText = QString("Progress: %1").arg(match.captured(1));
-            if (hasProgressLine) {
-                // Overwrite existing progress line
-                QTextCursor cursor = progressOutput->textCursor();
-                cursor.movePosition(QTextCursor::End);
-                cursor.select(QTextCursor::LineUnderCursor);
-                cursor.removeSelectedText();
-                cursor.insertText(progressText);
-            } else {
-                // Create new progress line
-                progressOutput->append(progressText);
-                hasProgressLine = true;
+// jobStateChanged: Logs results of the request's jobs and updates the filter index.
+void YouTubeDLPWindow::jobStateChanged(int row, int jobId) {
+    const DownloadJob &job = engine->job(jobId);
+    jobSearch->setStatus(row, JobsModel::stateName(job.state), errorClass(job.error));
+    jobSearchStale = true;
+    if (!requestJobs.contains(jobId)) return;
+    if (job.state == DownloadJob::Completed) {
+        QString usage = job.usage.valid ? QString(" (%1)").arg(job.usage.text()) : QString();
+        if (!job.renditions.isEmpty()) {
+            appendLog(QString("Completed: %1%2").arg(job.title, usage));
+            for (const DownloadJob::Output &output : job.renditions) {
+                appendLog(output.error.isEmpty() ? QString("  %1: %2").arg(output.label, output.file)
+                                                 : QString("  %1 failed: %2").arg(output.label, output.error));
             }
         } else {
-            // Append non-progress lines (e.g., errors)
-            progressOutput->append(trimmed);
+            QString pieces = job.outputs.size() > 1 ? QString(" and %1 chapters").arg(job.outputs.size() - 1) : QString();
+            appendLog(QString("Completed: %1%2%3").arg(job.destination, pieces, usage));
+        }
+    }
+    if (job.state == DownloadJob::Failed) appendLog(QString("Failed: %1: %2").arg(job.title, job.error));
+}
+
+// showSummary: Shows the overall progress of the request, once per table frame.
+void YouTubeDLPWindow::showSummary() {
+    // New rows and states only reach the filter's results through a fresh search
+    if (jobSearchStale && !jobFilterEdit->text().trimmed().isEmpty()) jobSearch->search(jobFilterEdit->text());
+    jobSearchStale = false;
+    if (requestJobs.isEmpty()) return; // Keep the last request's result
+
+    // Overall progress of the request; failed items count as finished
+    double percent = 0;
+    int finished = 0;
+    for (int id : requestJobs) {
+        const DownloadJob &item = engine->job(id);
+        bool done = item.state == DownloadJob::Completed || item.state == DownloadJob::Failed;
+        percent += done ? 100.0 : item.percent;
+        if (done) ++finished;
+    }
+    percent /= requestJobs.size();
+    QString progressText = QString("Progress: %1%").arg(percent, 0, 'f', 1);
+    if (requestJobs.size() > 1) progressText += QString(" (%1/%2 items finished)").arg(finished).arg(requestJobs.size());
+    summaryLabel->setText(progressText);
+}
+
+// filterJobs: Searches the jobs table for the filter text.
+void YouTubeDLPWindow::filterJobs(const QString &text) {
+    if (text.trimmed().isEmpty()) jobsProxy->clearFilter();
+    else jobSearch->search(text);
+}
+
+// appendLog: Appends engine output that is not tied to a progress update.
+void YouTubeDLPWindow::appendLog(const QString &message) {
+    progressOutput->append(message);
+}
+
+// engineIdle: Reports the result once every job of the request has finished.
+void YouTubeDLPWindow::engineIdle() {
+    if (requestJobs.isEmpty()) return;
+    bool ok = true;
+    for (int id : requestJobs) ok = ok && engine->job(id).state == DownloadJob::Completed;
+    requestJobs.clear();
+    finishDownload(ok);
+}
+
+// resetFormatMenus: Fills the quality and subtitle menus with the generic choices.
+// Video items carry their height cap (Qt::UserRole + 2), 0 meaning audio only; audio items
+// carry "original" or "mp3:<bitrate>" and subtitle items the language code.
+void YouTubeDLPWindow::resetFormatMenus() {
+    formatMenusUrl.clear();
+    menuFormats.clear();
+    menuMetadata = QJsonObject();
+    chaptersButton->setEnabled(false);
+    videoQualityCombo->clear();
+    const QList<QPair<QString, int>> heights = {{"4K (2160p)", 2160}, {"1080p", 1080}, {"720p", 720}, {"480p", 480}, {"None", 0}};
+    for (const auto &height : heights) {
+        videoQualityCombo->addItem(height.first, QString());
+        videoQualityCombo->setItemData(videoQualityCombo->count() - 1, height.second, Qt::UserRole + 2);
+    }
+    videoQualityCombo->setCurrentIndex(0); // Default to highest (4K)
+
+    audioQualityCombo->clear();
+    audioQualityCombo->addItem("Original (no re-encode)", "original"); // Best native stream, stored as-is
+    addMp3Choices();
+    audioQualityCombo->setCurrentIndex(0); // Default to passthrough
+
+    subtitleLangCombo->clear();
+    subtitleLangCombo->addItem("None", QString());
+    for (const QString &label : {"English (en)", "French (fr)", "Spanish (es)", "German (de)", "Italian (it)", "Portuguese (pt)", "Russian (ru)", "Japanese (ja)", "Chinese (zh)", "Arabic (ar)"}) {
+        subtitleLangCombo->addItem(label, label.section("(", 1, 1).section(")", 0, 0));
+    }
+    subtitleLangCombo->setCurrentIndex(0); // Default to None
+    updateCpuCost();
+}
+
+// populateFormatMenus: Rebuilds the quality and subtitle menus from a URL's probed formats.
+// Each option shows resolution, codec, size and whether it can be stored in the chosen
+// container without re-encoding; its item data is the exact format ID so yt-dlp
+// renegotiates nothing. The default pairing is the best remux-first choice.
+void YouTubeDLPWindow::populateFormatMenus(const QString &url, const QJsonObject &metadata) {
+    QList<MediaFormat> formats = parseFormats(metadata);
+    QList<MediaFormat> videos, audios;
+    for (const MediaFormat &format : formats) {
+        if (format.hasVideo()) videos << format;
+        else audios << format;
+    }
+    if (videos.isEmpty() && audios.isEmpty()) return;
+    QString policy = containerCombo->currentData().toString();
+    QString preferred = policy == "auto" ? QString("mp4") : policy; // Listed first at equal height
+    std::sort(videos.begin(), videos.end(), [&preferred](const MediaFormat &a, const MediaFormat &b) {
+        if (a.height != b.height) return a.height > b.height;
+        if (copiesInto(a, preferred) != copiesInto(b, preferred)) return copiesInto(a, preferred);
+        return a.tbr > b.tbr;
+    });
+    std::sort(audios.begin(), audios.end(), [](const MediaFormat &a, const MediaFormat &b) {
+        return a.abr > b.abr;
+    });
+
+    // Keep the user's choice: the same formats when only the container changed,
+    // otherwise the same height cap or audio only
+    bool sameUrl = formatMenusUrl == url;
+    QString previousVideo = sameUrl ? videoQualityCombo->currentData().toString() : QString();
+    QString previousAudio = sameUrl ? audioQualityCombo->currentData().toString() : QString();
+    int heightCap = videoQualityCombo->currentData(Qt::UserRole + 2).toInt();
+    bool audioOnly = heightCap == 0;
+    formatMenusUrl = url;
+    menuFormats = formats;
+    menuMetadata = metadata;
+    chaptersButton->setEnabled(!metadata["chapters"].toArray().isEmpty());
+
+    QSignalBlocker blockVideo(videoQualityCombo);
+    QSignalBlocker blockAudio(audioQualityCombo);
+    QString container = policy == "auto" ? QString() : policy;
+    videoQualityCombo->clear();
+    for (const MediaFormat &format : videos) {
+        QString label = QString("%1p").arg(format.height);
+        if (format.fps > 30) label += QString::number(qRound(format.fps));
+        label += ", " + format.vcodec;
+        if (format.hasAudio()) label += " + " + format.acodec;
+        label += ", " + sizeText(format.size, format.sizeIsEstimate);
+        label += container.isEmpty() || containerAccepts(container, format.vcodec) ? ", remux" : ", needs re-encode";
+        videoQualityCombo->addItem(label, format.id);
+        videoQualityCombo->setItemData(videoQualityCombo->count() - 1, !format.hasAudio(), Qt::UserRole + 1);
+        videoQualityCombo->setItemData(videoQualityCombo->count() - 1, format.height, Qt::UserRole + 2);
+    }
+    videoQualityCombo->addItem("None", QString()); // Audio only
+    videoQualityCombo->setItemData(videoQualityCombo->count() - 1, 0, Qt::UserRole + 2);
+
+    audioQualityCombo->clear();
+    for (const MediaFormat &format : audios) {
+        QString label = QString("%1kbps, %2 (%3), %4").arg(qRound(format.abr)).arg(format.acodec, format.ext,
+                                                                                 sizeText(format.size, format.sizeIsEstimate));
+        if (!container.isEmpty() && !containerAccepts(container, format.acodec)) label += ", needs re-encode";
+        audioQualityCombo->addItem(label, format.id);
+    }
+    if (audios.isEmpty()) audioQualityCombo->addItem("Original (no re-encode)", "original");
+    addMp3Choices();
+
+    if (audioOnly) {
+        videoQualityCombo->setCurrentIndex(videoQualityCombo->count() - 1);
+        audioQualityCombo->setCurrentIndex(0);
+    } else if (!previousVideo.isEmpty() && videoQualityCombo->findData(previousVideo) >= 0) {
+        videoQualityCombo->setCurrentIndex(videoQualityCombo->findData(previousVideo));
+        audioQualityCombo->setCurrentIndex(qMax(0, audioQualityCombo->findData(previousAudio)));
+    } else {
+        // Default to the best-scoring pairing, which avoids transcoding whenever possible
+        QList<FormatChoice> ranked = rankFormats(formats, heightCap >= 2160 ? 0 : heightCap, policy);
+        if (!ranked.isEmpty()) {
+            videoQualityCombo->setCurrentIndex(qMax(0, videoQualityCombo->findData(ranked.first().videoId)));
+            audioQualityCombo->setCurrentIndex(qMax(0, audioQualityCombo->findData(ranked.first().audioId)));
         }
     }
-    // Scroll to show latest output
-    progressOutput->moveCursor(QTextCursor::End);
-    progressOutput->ensureCursorVisible();
+
+    if (!sameUrl) {
+        // Subtitles the video really has; automatic captions need --write-auto-subs
+        subtitleLangCombo->clear();
+        subtitleLangCombo->addItem("None", QString());
+        auto addSubtitles = [this](const QJsonObject &tracks, bool automatic) {
+            for (auto it = tracks.begin(); it != tracks.end(); ++it) {
+                QString name = it.value().toArray().at(0).toObject()["name"].toString(it.key());
+                QString label = QString("%1 (%2)%3").arg(name, it.key(), automatic ? " [auto]" : "");
+                subtitleLangCombo->addItem(label, it.key());
+                subtitleLangCombo->setItemData(subtitleLangCombo->count() - 1, automatic, Qt::UserRole + 1);
+            }
+        };
+        addSubtitles(metadata["subtitles"].toObject(), false);
+        addSubtitles(metadata["automatic_captions"].toObject(), true);
+        subtitleLangCombo->setCurrentIndex(0);
+    }
+    updateCpuCost();
+}
+
+// addMp3Choices: Appends the explicit MP3 conversions to the audio menu.
+// Item data "mp3:<bitrate>" marks them; every other audio choice is stored without re-encoding.
+void YouTubeDLPWindow::addMp3Choices() {
+    if (audioQualityCombo->count() > 0) audioQualityCombo->insertSeparator(audioQualityCombo->count());
+    for (const QString &bitrate : {"320", "256", "128"}) {
+        audioQualityCombo->addItem(QString("MP3 %1kbps (re-encode)").arg(bitrate), QString("mp3:%1K").arg(bitrate));
+    }
+}
+
+// audioOnlyArgs: yt-dlp arguments for the audio-only ("None") video choice.
+// The native stream is stored untouched (m4a/opus/webm) unless MP3 was explicitly chosen,
+// which is the only case that decodes and re-encodes the audio (in the postprocessing stage).
+QStringList YouTubeDLPWindow::audioOnlyArgs() const {
+    QString choice = audioQualityCombo->currentData().toString();
+    const MediaFormat *audio = menuFormat(choice);
+    return QStringList() << "-f" << (audio ? audio->id : QString("ba/b"));
+}
+
+// menuFormat: Returns the probed format with the given ID, or nullptr.
+const MediaFormat *YouTubeDLPWindow::menuFormat(const QString &formatId) const {
+    for (const MediaFormat &format : menuFormats) {
+        if (format.id == formatId) return &format;
+    }
+    return nullptr;
+}
+
+// selectedFormatArgs: yt-dlp format arguments for the current menu selections.
+QStringList YouTubeDLPWindow::selectedFormatArgs() const {
+    QString policy = containerCombo->currentData().toString();
+    int height = videoQualityCombo->currentData(Qt::UserRole + 2).toInt();
+    if (formatMenusUrl.isEmpty()) return genericFormatArgs(height, policy);
+    const MediaFormat *video = menuFormat(videoQualityCombo->currentData().toString());
+    if (!video) return genericFormatArgs(height, policy);
+    const MediaFormat *audio = video->hasAudio() ? nullptr : menuFormat(audioQualityCombo->currentData().toString());
+    if (!video->hasAudio() && !audio) audio = bestAudioFor(*video, menuFormats, policy); // An MP3 choice was picked
+    if (!video->hasAudio() && !audio) return QStringList() << "-f" << video->id + ",ba/b";
+    return chooseContainer(*video, audio, policy).args();
+}
+
+// videoFormatActivated: Pairs a newly picked video format with the audio that transcodes least.
+void YouTubeDLPWindow::videoFormatActivated(int index) {
+    Q_UNUSED(index); // The current data is read instead
+    const MediaFormat *video = menuFormat(videoQualityCombo->currentData().toString());
+    if (video && !video->hasAudio()) {
+        const MediaFormat *audio = bestAudioFor(*video, menuFormats, containerCombo->currentData().toString());
+        if (audio) audioQualityCombo->setCurrentIndex(qMax(0, audioQualityCombo->findData(audio->id)));
+    }
+    updateCpuCost();
+}
+
+// containerChanged: Relabels the probed formats for the new container and updates the CPU cost.
+void YouTubeDLPWindow::containerChanged(int index) {
+    Q_UNUSED(index); // The current data is read instead
+    if (!formatMenusUrl.isEmpty()) {
+        populateFormatMenus(formatMenusUrl, menuMetadata);
+    } else {
+        updateCpuCost();
+    }
+}
+
+// updateCpuCost: Shows how much transcoding the current selection is expected to need.
+void YouTubeDLPWindow::updateCpuCost() {
+    if (!cpuCostLabel) return; // Menus are filled before the label exists
+    QString policy = containerCombo->currentData().toString();
+    int height = videoQualityCombo->currentData(Qt::UserRole + 2).toInt();
+    const MediaFormat *video = menuFormat(videoQualityCombo->currentData().toString());
+    QString text;
+    if (height == 0 && !video) {
+        text = audioQualityCombo->currentData().toString().startsWith("mp3:")
+                   ? "CPU: medium (audio decoded and re-encoded to MP3)"
+                   : "CPU: none (original audio stored untouched)";
+    } else if (!video) {
+        text = policy == "auto" ? "CPU: none (stream copy into MP4, WebM or MKV)"
+                                : QString("CPU: none if matching streams exist (%1)").arg(policy.toUpper());
+    } else {
+        const MediaFormat *audio = video->hasAudio() ? nullptr : menuFormat(audioQualityCombo->currentData().toString());
+        if (!video->hasAudio() && !audio) audio = bestAudioFor(*video, menuFormats, policy);
+        text = chooseContainer(*video, audio, policy).costText();
+    }
+    cpuCostLabel->setText(text);
 }
 
-// processFinished: Handles yt-dlp completion or failure.
-void YouTubeDLPWindow::processFinished(int exitCode, QProcess::ExitStatus exitStatus) {
-    Q_UNUSED(exitStatus); // Avoid unused parameter warning
+// finishDownload: Reports the result and re-enables the Download button.
+void YouTubeDLPWindow::finishDownload(bool ok) {
     // Append completion message with ASCII separators
     progressOutput->append("---------------------");
-    progressOutput->append(exitCode == 0 ? "Download Complete" : "Download Failed");
+    progressOutput->append(ok ? "Download Complete" : "Download Failed");
     progressOutput->append("---------------------");
     // Reset button to allow new downloads
     downloadButton->setText("Download");
     downloadButton->setEnabled(true);
-    process->deleteLater(); // Schedule process cleanup
-    process = nullptr;
+}
+
+// runWorkerBenchmark: Compares per-job overhead of spawning yt-dlp with warm workers.
+// Usage: youtube_dlp_gui --benchmark-workers [jobs] [url]
+// Without a URL each job is a no-op ("yt-dlp --version" vs. a worker ping), which
+// isolates interpreter and import startup; with a URL each job is a metadata probe.
+static int runWorkerBenchmark(const QStringList &arguments) {
+    QTextStream out(stdout);
+    int jobs = qMax(1, arguments.value(2, "10").toInt());
+    QString url = arguments.value(3);
+
+    // Spawn-per-job model, as startDownload() used to do for every probe and download
+    QStringList spawnArgs = url.isEmpty() ? QStringList{"--version"} : QStringList{"-J", "--flat-playlist", url};
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < jobs; ++i) {
+        QProcess process;
+        process.start("yt-dlp", spawnArgs);
+        if (!process.waitForFinished(-1) || process.exitCode() != 0) {
+            out << "yt-dlp failed: " << process.errorString() << Qt::endl;
+            return 1;
+        }
+    }
+    double spawnMs = double(timer.elapsed()) / jobs;
+
+    // Warm-worker model: startup is paid once, by the first ping
+    QEventLoop loop;
+    WorkerPool pool(1, ProcessPriority::named("interactive"));
+    auto runJob = [&](const QJsonObject &request) {
+        bool ok = false;
+        int jobId = pool.submit(request);
+        auto finished = QObject::connect(&pool, &WorkerPool::jobFinished, &loop,
+                                         [&](int id, bool jobOk, const QString &error) {
+            if (id != jobId) return;
+            if (!jobOk) out << "Worker job failed: " << error << Qt::endl;
+            ok = jobOk;
+            loop.quit();
+        });
+        auto rejected = QObject::connect(&pool, &WorkerPool::jobRejected, &loop, [&](int id) {
+            if (id != jobId) return;
+            out << "Warm workers unavailable (python3 with the yt_dlp module is required)" << Qt::endl;
+            loop.quit();
+        });
+        loop.exec();
+        QObject::disconnect(finished);
+        QObject::disconnect(rejected);
+        return ok;
+    };
+    QJsonObject ping;
+    ping["op"] = "ping";
+    timer.start();
+    if (!runJob(ping)) return 1;
+    double warmupMs = timer.elapsed();
+
+    QJsonObject request = ping;
+    if (!url.isEmpty()) {
+        request["op"] = "probe";
+        request["urls"] = QJsonArray{url};
+    }
+    timer.start();
+    for (int i = 0; i < jobs; ++i) {
+        if (!runJob(request)) return 1;
+    }
+    double warmMs = double(timer.elapsed()) / jobs;
+
+    out << "Jobs:                " << jobs << (url.isEmpty() ? " (no-op)" : " (probe)") << Qt::endl;
+    out << "Spawn per job:       " << QString::number(spawnMs, 'f', 1) << " ms/job" << Qt::endl;
+    out << "Warm worker:         " << QString::number(warmMs, 'f', 1) << " ms/job" << Qt::endl;
+    out << "Worker warm-up:      " << QString::number(warmupMs, 'f', 1) << " ms (once)" << Qt::endl;
+    out << "Overhead saved:      " << QString::number(spawnMs - warmMs, 'f', 1) << " ms/job" << Qt::endl;
+    return 0;
+}
+
+// childCpuSeconds: User plus system CPU time of all waited-for child processes so far.
+static double childCpuSeconds() {
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+         + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#else
+    return 0;
+#endif
+}
+
+// runAudioBenchmark: Compares CPU seconds per hour of audio for passthrough and MP3 output.
+// Usage: youtube_dlp_gui --benchmark-audio <file> [file...]
+// Each file (e.g. a downloaded .webm/.m4a) is stored once as-is with a stream copy and once
+// converted the way "-x --audio-format mp3" does; ffmpeg's CPU time is normalized by duration.
+static int runAudioBenchmark(const QStringList &arguments) {
+    QTextStream out(stdout);
+    QStringList files = arguments.mid(2);
+#ifndef Q_OS_UNIX
+    out << "CPU accounting for child processes requires a Unix system" << Qt::endl;
+    return 1;
+#endif
+    if (files.isEmpty()) {
+        out << "Usage: youtube_dlp_gui --benchmark-audio <file> [file...]" << Qt::endl;
+        return 2;
+    }
+    QTemporaryDir scratch;
+    double hours = 0, copySeconds = 0, mp3Seconds = 0;
+    auto runFfmpeg = [&out](const QStringList &args) {
+        double before = childCpuSeconds();
+        QProcess ffmpeg;
+        ffmpeg.start("ffmpeg", QStringList() << "-v" << "error" << "-y" << args);
+        if (!ffmpeg.waitForFinished(-1) || ffmpeg.exitCode() != 0) {
+            out << "ffmpeg failed: " << ffmpeg.readAllStandardError() << ffmpeg.errorString() << Qt::endl;
+            return -1.0;
+        }
+        return childCpuSeconds() - before;
+    };
+    for (const QString &file : files) {
+        QProcess ffprobe;
+        ffprobe.start("ffprobe", QStringList() << "-v" << "error" << "-show_entries" << "format=duration"
+                                               << "-of" << "default=noprint_wrappers=1:nokey=1" << file);
+        ffprobe.waitForFinished(-1);
+        double duration = ffprobe.readAllStandardOutput().trimmed().toDouble();
+        if (duration <= 0) {
+            out << "Cannot read the duration of " << file << Qt::endl;
+            return 1;
+        }
+        double copy = runFfmpeg(QStringList() << "-i" << file << "-vn" << "-c:a" << "copy"
+                                              << scratch.filePath("passthrough.mka"));
+        double mp3 = runFfmpeg(QStringList() << "-i" << file << "-vn" << "-c:a" << "libmp3lame"
+                                             << "-b:a" << "320k" << scratch.filePath("converted.mp3"));
+        if (copy < 0 || mp3 < 0) return 1;
+        hours += duration / 3600.0;
+        copySeconds += copy;
+        mp3Seconds += mp3;
+    }
+    out << "Audio:               " << QString::number(hours * 60, 'f', 1) << " minutes in " << files.size() << " file(s)" << Qt::endl;
+    out << "Passthrough (copy):  " << QString::number(copySeconds / hours, 'f', 2) << " CPU s per hour of audio" << Qt::endl;
+    out << "MP3 320k re-encode:  " << QString::number(mp3Seconds / hours, 'f', 2) << " CPU s per hour of audio" << Qt::endl;
+    out << "Note: the GUI's passthrough mode skips even the copy pass and stores the download as-is." << Qt::endl;
+    return 0;
+}
+
+// peakResidentKb: Peak resident set size of this process (VmHWM), 0 where unavailable.
+static qint64 peakResidentKb() {
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly)) return 0;
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:")) return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+    }
+    return 0;
+}
+
+// runJsonParse: Child side of --benchmark-json; parses one dump and prints "ms entries peak_kb".
+// "dom" repeats what reading a probe used to do: all output at once, converted to QString and
+// back, a full QJsonDocument and a copy of "entries". "stream" feeds the ProbeReader 64 KB at a time.
+static int runJsonParse(const QStringList &arguments) {
+    QString mode = arguments.value(2);
+    QFile file(arguments.value(3));
+    if (!file.open(QIODevice::ReadOnly)) return 1;
+    QElapsedTimer timer;
+    timer.start();
+    int entries = 0;
+    if (mode == "dom") {
+        QByteArray output = file.readAll();
+        QString text = QString::fromUtf8(output);
+        QJsonDocument document = QJsonDocument::fromJson(text.toUtf8());
+        QJsonArray list = document.object()["entries"].toArray();
+        entries = list.size();
+    } else {
+        ProbeReader reader;
+        while (!file.atEnd()) {
+            reader.feed(file.read(64 * 1024));
+            while (reader.read() == ProbeReader::Document) entries += reader.document()["entries"].toArray().size();
+        }
+        reader.finish();
+        while (reader.read() == ProbeReader::Document) entries += reader.document()["entries"].toArray().size();
+    }
+    QTextStream(stdout) << timer.elapsed() << ' ' << entries << ' ' << peakResidentKb() << Qt::endl;
+    return 0;
+}
+
+// runJsonBenchmark: Compares time and peak memory of DOM and streaming probe parsing.
+// Usage: youtube_dlp_gui --benchmark-json [entries...]   (default: 10000 100000)
+// Each size gets a synthetic flat-playlist dump shaped like "yt-dlp -J" output; every
+// parse runs in a fresh child process so its peak RSS is measured in isolation.
+static int runJsonBenchmark(const QStringList &arguments) {
+    QTextStream out(stdout);
+    QList<int> sizes;
+    for (const QString &argument : arguments.mid(2)) sizes << qMax(1, argument.toInt());
+    if (sizes.isEmpty()) sizes << 10000 << 100000;
+    QTemporaryDir scratch;
+    for (int size : sizes) {
+        QString path = scratch.filePath(QString("dump-%1.json").arg(size));
+        QFile dump(path);
+        if (!dump.open(QIODevice::WriteOnly)) {
+            out << "Cannot write " << path << Qt::endl;
+            return 1;
+        }
+        // Written entry by entry so the parent's own memory stays flat
+        dump.write(R"({"id": "UCbenchmark", "title": "Benchmark channel", "_type": "playlist", )"
+                   R"("webpage_url": "https://www.youtube.com/@benchmark", "entries": [)");
+        QByteArray description(400, 'x');
+        for (int i = 0; i < size; ++i) {
+            QString id = QString("vid%1").arg(i, 8, 10, QChar('0'));
+            QByteArray entry = QString(R"(%1{"_type": "url", "ie_key": "Youtube", "id": "%2", "url": "https://www.youtube.com/watch?v=%2", )"
+                                       R"("title": "Video number %3 \"with quotes\" and \u00e9scapes", "duration": %4, )"
+                                       R"("channel": "Benchmark", "uploader": "Benchmark", "view_count": %5, "description": "%6", )"
+                                       R"("thumbnails": [{"url": "https://i.ytimg.com/vi/%2/hqdefault.jpg", "height": 360, "width": 480}, )"
+                                       R"({"url": "https://i.ytimg.com/vi/%2/maxresdefault.jpg", "height": 1080, "width": 1920}]})")
+                                   .arg(QString(i ? ", " : ""), id).arg(i).arg(60 + i % 3600).arg(i * 7).arg(QString::fromLatin1(description))
+                                   .toUtf8();
+            dump.write(entry);
+        }
+        dump.write("]}\n");
+        dump.close();
+        out << "Entries: " << size << " (" << sizeText(QFileInfo(path).size()) << " of JSON)" << Qt::endl;
+        for (const QString &mode : {QString("dom"), QString("stream")}) {
+            QProcess child;
+            child.start(QCoreApplication::applicationFilePath(), QStringList() << "--benchmark-json-parse" << mode << path);
+            child.waitForFinished(-1);
+            QStringList fields = QString::fromUtf8(child.readAllStandardOutput()).split(' ', Qt::SkipEmptyParts);
+            if (child.exitCode() != 0 || fields.size() < 3) {
+                out << "  " << mode << ": parse failed" << Qt::endl;
+                return 1;
+            }
+            out << "  " << (mode == "dom" ? "QJsonDocument:  " : "Streaming:      ") << fields.at(0) << " ms, " << fields.at(1).trimmed()
+                << " entries, peak RSS " << sizeText(fields.at(2).trimmed().toLongLong() * 1024) << Qt::endl;
+        }
+    }
+    return 0;
+}
+
+// runSearchBenchmark: Times per-keystroke queries against a synthetic search index.
+// Usage: youtube_dlp_gui --benchmark-search [rows]   (default: 100000)
+// Every prefix of a few typical queries is run, as typing them would.
+static int runSearchBenchmark(const QStringList &arguments) {
+    QTextStream out(stdout);
+    int rows = qMax(1, arguments.value(2, "100000").toInt());
+    static const char *const words[] = {"live", "official", "trailer", "music", "video", "review", "tutorial",
+                                        "part", "episode", "remix", "cover", "highlights", "interview", "podcast",
+                                        "news", "full", "album", "lyrics", "reaction", "guide"};
+    SearchIndex index;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < rows; ++i) {
+        SearchIndex::Document document;
+        document.title = QString("%1 %2 %3 #%4").arg(QString(words[i % 20]), QString(words[i / 20 % 20]), QString(words[i * 7 % 20])).arg(i);
+        document.channel = QString("Channel %1").arg(i % 500);
+        document.id = QString("vid%1").arg(i, 8, 10, QChar('0'));
+        document.state = i % 10 == 0 ? "failed" : i % 3 ? "completed" : "queued";
+        document.errorClass = i % 10 == 0 ? (i % 20 ? "network" : "unavailable") : "";
+        index.add(i, document);
+    }
+    qint64 buildMs = timer.elapsed();
+    QStringList queries;
+    for (const QString &text : {QString("official trailer"), QString("state:failed channel:channel 42"),
+                                QString("id:vid0004"), QString("error:net re")}) {
+        for (int length = 1; length <= text.size(); ++length) queries << text.left(length);
+    }
+    double total = 0, slowest = 0;
+    QString slowestQuery;
+    for (const QString &query : queries) {
+        timer.start();
+        QBitArray matches = index.search(query);
+        double milliseconds = timer.nsecsElapsed() / 1e6;
+        total += milliseconds;
+        if (milliseconds > slowest) {
+            slowest = milliseconds;
+            slowestQuery = query;
+        }
+    }
+    out << "Rows:                " << rows << Qt::endl;
+    out << "Index build:         " << buildMs << " ms (on the index thread in the app)" << Qt::endl;
+    out << "Keystroke queries:   " << queries.size() << ", average " << QString::number(total / queries.size(), 'f', 2) << " ms" << Qt::endl;
+    out << "Slowest:             " << QString::number(slowest, 'f', 2) << " ms for \"" << slowestQuery << "\"" << Qt::endl;
+    return 0;
+}
+
+// runThumbnailBenchmark: Loads thumbnails through the two cache tiers from a stand-in server
+// and reports how long each pass took and the longest the event loop was blocked meanwhile.
+// Usage: youtube_dlp_gui --benchmark-thumbnails <base-url> [count]   (default: 500)
+// The server has to answer <base-url>/<n>.jpg for every n below count, e.g.
+// "python3 -m http.server" in a folder of numbered copies of one thumbnail.
+static int runThumbnailBenchmark(const QStringList &arguments) {
+    QTextStream out(stdout);
+    QString base = arguments.value(2);
+    int count = qMax(1, arguments.value(3, "500").toInt());
+    if (base.isEmpty()) {
+        out << "Usage: --benchmark-thumbnails <base-url> [count]" << Qt::endl;
+        return 2;
+    }
+    if (base.endsWith('/')) base.chop(1);
+    QStringList urls;
+    for (int i = 0; i < count; ++i) urls << QString("%1/%2.jpg").arg(base).arg(i);
+    QTemporaryDir directory;
+
+    // A 1 ms heartbeat: a long gap between beats means the GUI thread was blocked
+    QElapsedTimer beat;
+    qint64 stall = 0;
+    QTimer heartbeat;
+    heartbeat.setInterval(1);
+    QObject::connect(&heartbeat, &QTimer::timeout, [&] { stall = qMax(stall, beat.restart()); });
+
+    // pass: Asks for every image, as painting the rows would, and waits until all have arrived.
+    auto pass = [&](const QString &name, ThumbnailCache &cache) {
+        QElapsedTimer timer;
+        timer.start();
+        stall = 0;
+        beat.start();
+        heartbeat.start();
+        QSet<QString> pending;
+        for (const QString &url : urls) {
+            if (cache.image(url).isNull()) pending.insert(url);
+        }
+        int immediate = count - pending.size();
+        QEventLoop loop;
+        QObject::connect(&cache, &ThumbnailCache::ready, &loop, [&](const QString &url) {
+            if (pending.remove(url) && pending.isEmpty()) loop.quit();
+        });
+        QTimer::singleShot(30000, &loop, &QEventLoop::quit); // Failed loads never answer
+        if (!pending.isEmpty()) loop.exec();
+        heartbeat.stop();
+        out << name.leftJustified(21) << timer.elapsed() << " ms, " << immediate << " from memory, "
+            << count - immediate - pending.size() << " loaded, " << pending.size() << " failed; longest stall "
+            << stall << " ms" << Qt::endl;
+    };
+
+    ThumbnailCache cold(QSize(64, 36), directory.path());
+    pass("Network + decode:", cold);
+    pass("Memory tier:", cold);
+    ThumbnailCache restarted(QSize(64, 36), directory.path()); // As after restarting the app
+    pass("Disk tier + decode:", restarted);
+    return 0;
+}
+
+// runSponsorImport: Imports SponsorBlock's sponsorTimes.csv dump into the local segment store.
+// Usage: youtube_dlp_gui --import-sponsorblock <sponsorTimes.csv or URL> [store]
+// A URL (a mirror or a local stand-in server) is downloaded to a temporary file first.
+static int runSponsorImport(const QStringList &arguments) {
+    QTextStream out(stdout);
+    QString source = arguments.value(2);
+    QString path = arguments.value(3, SponsorStore::defaultPath());
+    if (source.isEmpty()) {
+        out << "Usage: --import-sponsorblock <sponsorTimes.csv or URL> [store]" << Qt::endl;
+        return 2;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    QTemporaryFile download;
+    QFile file(source);
+    QIODevice *csv = &file;
+    if (source.startsWith("http://") || source.startsWith("https://")) {
+        if (!download.open()) {
+            out << "Cannot create a temporary file: " << download.errorString() << Qt::endl;
+            return 1;
+        }
+        QNetworkAccessManager network;
+        QNetworkReply *reply = network.get(QNetworkRequest(QUrl(source)));
+        QEventLoop loop;
+        // Written as it arrives; the dump is several GB
+        QObject::connect(reply, &QNetworkReply::readyRead, [&] { download.write(reply->readAll()); });
+        QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+        loop.exec();
+        download.write(reply->readAll());
+        if (reply->error() != QNetworkReply::NoError) {
+            out << "Download failed: " << reply->errorString() << Qt::endl;
+            return 1;
+        }
+        out << "Downloaded " << sizeText(download.size()) << " in " << timer.elapsed() << " ms" << Qt::endl;
+        download.seek(0);
+        csv = &download;
+    } else if (!file.open(QIODevice::ReadOnly)) {
+        out << "Cannot read " << source << ": " << file.errorString() << Qt::endl;
+        return 1;
+    }
+    timer.start();
+    QString summary;
+    bool ok = SponsorStore::import(csv, path, &summary);
+    out << summary << Qt::endl;
+    if (ok) out << "Store: " << path << " (" << sizeText(QFileInfo(path).size()) << ", " << timer.elapsed() << " ms)" << Qt::endl;
+    return ok ? 0 : 1;
+}
+
+// runSponsorBenchmark: Imports a synthetic dump and times store lookups.
+// Usage: youtube_dlp_gui --benchmark-sponsorblock [videos]   (default: 100000)
+static int runSponsorBenchmark(const QStringList &arguments) {
+    QTextStream out(stdout);
+    int videos = qMax(1, arguments.value(2, "100000").toInt());
+    QTemporaryDir directory;
+    QByteArray dump = "videoID,startTime,endTime,votes,locked,incorrectVotes,UUID,userID,timeSubmitted,views,"
+                      "category,actionType,service,videoDuration,hidden,reputation,shadowHidden,hashedVideoID,"
+                      "userAgent,description\n";
+    for (int i = 0; i < videos; ++i) {
+        QByteArray id = QByteArray::number(i, 36).rightJustified(11, '0');
+        for (int segment = 0; segment < 2; ++segment) {
+            double start = 30.0 + segment * 300 + i % 60;
+            dump += id + ',' + QByteArray::number(start) + ',' + QByteArray::number(start + 45) + ",3,0,1,uuid,user,"
+                  "1600000000000,10," + (segment ? "outro" : "sponsor") + ",skip,YouTube,900,0,1,0,hash,"
+                  "\"Mozilla/5.0 (X11, Linux)\",\"\"\n";
+        }
+    }
+    QBuffer csv(&dump);
+    csv.open(QIODevice::ReadOnly);
+    QString path = directory.path() + "/sponsorblock.db";
+    QElapsedTimer timer;
+    timer.start();
+    QString summary;
+    if (!SponsorStore::import(&csv, path, &summary)) {
+        out << summary << Qt::endl;
+        return 1;
+    }
+    qint64 importMs = timer.elapsed();
+
+    SponsorStore store(path);
+    int lookups = 100000, found = 0;
+    SponsorStore::Segments segments;
+    timer.start();
+    for (int i = 0; i < lookups; ++i) {
+        // Spread over all ids, so the recent-lookup cache rarely helps
+        int video = int((quint64(i) * 2654435761u) % quint64(videos));
+        if (store.find(QString::fromLatin1(QByteArray::number(video, 36).rightJustified(11, '0')), &segments)) ++found;
+    }
+    double lookupUs = timer.nsecsElapsed() / 1e3 / lookups;
+    out << "Dump:                " << sizeText(dump.size()) << ", " << summary << Qt::endl;
+    out << "Import:              " << importMs << " ms, store " << sizeText(QFileInfo(path).size()) << Qt::endl;
+    out << "Lookups:             " << lookups << ", " << found << " found, average " << QString::number(lookupUs, 'f', 2) << " us" << Qt::endl;
+    return 0;
+}
+
+// runSelfCheck: Checks the time parsers, output naming, the choice of cut-boundary encoder
+// and store reads of damaged files against known answers; prints each failure.
+// Usage: youtube_dlp_gui --self-check
+static int runSelfCheck() {
+    QTextStream out(stdout);
+    int failures = 0;
+    auto check = [&out, &failures](bool ok, const QString &what) {
+        if (ok) return;
+        out << "FAIL: " << what << Qt::endl;
+        ++failures;
+    };
+
+    // Times and sections
+    check(parseTimestamp("90") == 90 && parseTimestamp("1:02:03.5") == 3723.5, "parseTimestamp reads s and h:mm:ss");
+    check(parseTimestamp("1:x") < 0 && parseTimestamp("1:2:3:4") < 0, "parseTimestamp rejects malformed times");
+    check(timestampText(3723.5) == "1:02:03.500" && timestampText(65) == "1:05", "timestampText");
+    QString error;
+    QList<QPair<double, double>> sections = parseSections("2:05:00-2:05:30, 1:00-1:30", &error);
+    check(sections.size() == 2 && sections.first() == qMakePair(60.0, 90.0), "parseSections sorts the ranges");
+    check(parseSections("1:30-1:00", &error).isEmpty() && !error.isEmpty(), "parseSections rejects an empty range");
+
+    // Output names never replace a file
+    check(numberedFileName("/save/Title.mp4", 1) == "/save/Title.mp4", "numberedFileName keeps the first name");
+    check(numberedFileName("/save/Title [480p].mp4", 2) == "/save/Title [480p] (2).mp4", "numberedFileName numbers the name");
+    check(numberedFileName("/save/Title", 3) == "/save/Title (3)", "numberedFileName without a suffix");
+
+    // Cut boundaries are only re-encoded where the spliced stream stays valid
+    QString x264 = boundaryEncoder("avc1", "Main", 31, "yuv420p").join(' ');
+    check(x264.contains("libx264") && x264.contains("-profile:v main -level:v 3.1") && x264.endsWith("-pix_fmt yuv420p"),
+          "boundaryEncoder matches the H.264 profile and level");
+    check(!boundaryEncoder("vp9", QString(), 0, "yuv420p").isEmpty(), "boundaryEncoder re-encodes VP9");
+    check(boundaryEncoder("hevc", "Main", 120, "yuv420p").isEmpty() && boundaryEncoder("av1", "Main", 8, "yuv420p").isEmpty(),
+          "boundaryEncoder leaves HEVC and AV1 at the keyframe before");
+    check(boundaryEncoder("avc1", "High", 0, "yuv420p").isEmpty() && boundaryEncoder("avc1", "High", 40, QString()).isEmpty(),
+          "boundaryEncoder needs the level and pixel format");
+
+    // Store lookups, then every truncation of the file and a corrupted slot and record
+    QTemporaryDir directory;
+    QByteArray dump = "videoID,startTime,endTime,votes,locked,category,actionType,service,hidden,shadowHidden\n"
+                      "aaaaaaaaaaa,30.5,75,3,0,sponsor,skip,YouTube,0,0\n"
+                      "aaaaaaaaaaa,330.25,375,3,0,outro,skip,YouTube,0,0\n"
+                      "bbbbbbbbbbb,10,20,-1,0,sponsor,skip,YouTube,0,0\n";
+    QBuffer csv(&dump);
+    csv.open(QIODevice::ReadOnly);
+    QString path = directory.filePath("sponsorblock.db"), summary;
+    bool imported = SponsorStore::import(&csv, path, &summary);
+    check(imported, "SponsorStore::import: " + summary);
+    const SponsorStore::Segments expected = {qMakePair(30.5, 75.0), qMakePair(330.25, 375.0)};
+    SponsorStore::Segments segments;
+    {
+        SponsorStore store(path);
+        check(store.find("aaaaaaaaaaa", &segments) && segments == expected, "SponsorStore::find returns the segments");
+        check(!store.find("bbbbbbbbbbb", &segments) && !store.find("ccccccccccc", &segments), "SponsorStore::find of unknown ids");
+    }
+    QFile whole(path);
+    QByteArray bytes = whole.open(QIODevice::ReadOnly) ? whole.readAll() : QByteArray();
+    auto damaged = [&directory](const QString &name, const QByteArray &content) {
+        QString file = directory.filePath(name);
+        QFile damage(file);
+        if (damage.open(QIODevice::WriteOnly)) damage.write(content);
+        return file;
+    };
+    for (int length = 0; length < bytes.size(); ++length) {
+        SponsorStore store(damaged(QString("cut%1.db").arg(length), bytes.left(length)));
+        check(!store.find("aaaaaaaaaaa", &segments) || segments == expected, QString("SponsorStore::find of %1 bytes").arg(length));
+    }
+    const int records = 32 + 2 * 8; // Header and the two slots of the one video
+    QByteArray badSlot = bytes, badRecord = bytes;
+    for (int slot = 32; slot < records; slot += 8) memset(badSlot.data() + slot, 0x7f, 8);
+    if (badRecord.size() > records) badRecord[records] = char(255); // Id length past the end
+    SponsorStore slotStore(damaged("slot.db", badSlot)), recordStore(damaged("record.db", badRecord));
+    check(!slotStore.find("aaaaaaaaaaa", &segments), "SponsorStore::find with a corrupted slot");
+    check(!recordStore.find("aaaaaaaaaaa", &segments), "SponsorStore::find with a corrupted record");
+
+    out << (failures ? QString("%1 check(s) failed").arg(failures) : QString("All checks passed")) << Qt::endl;
+    return failures ? 1 : 0;
+}
+
+// runBenchmark: Dispatches --benchmark-* command-line modes; they run without a GUI.
+static int runBenchmark(const QStringList &arguments) {
+    QString mode = arguments.value(1);
+    if (mode == "--benchmark-workers") return runWorkerBenchmark(arguments);
+    if (mode == "--benchmark-audio") return runAudioBenchmark(arguments);
+    if (mode == "--benchmark-json") return runJsonBenchmark(arguments);
+    if (mode == "--benchmark-json-parse") return runJsonParse(arguments);
+    if (mode == "--benchmark-search") return runSearchBenchmark(arguments);
+    if (mode == "--benchmark-thumbnails") return runThumbnailBenchmark(arguments);
+    if (mode == "--benchmark-sponsorblock") return runSponsorBenchmark(arguments);
+    QTextStream(stderr) << "Unknown benchmark: " << mode << Qt::endl;
+    return 2;
 }
 
 // main: Entry point, creates and runs the Qt application.
 int main(int argc, char *argv[]) {
+    if (argc > 1 && QByteArray(argv[1]).startsWith("--benchmark")) {
+        QCoreApplication app(argc, argv); // Headless, no display needed
+        return runBenchmark(app.arguments());
+    }
+    if (argc > 1 && QByteArray(argv[1]) == "--self-check") {
+        QCoreApplication app(argc, argv);
+        return runSelfCheck();
+    }
+    if (argc > 1 && QByteArray(argv[1]) == "--import-sponsorblock") {
+        QCoreApplication app(argc, argv);
+        return runSponsorImport(app.arguments());
+    }
     QApplication app(argc, argv); // Initialize Qt application
+    CgroupTree::shared(); // Leave the delegated cgroup before any child process starts
     YouTubeDLPWindow window; // Create main window
     window.show(); // Display - Show window
     return app.exec(); // Run event loop
@@ -1,4 +1,8 @@
-QT += core gui widgets
+QT += core gui widgets network
 TARGET = youtube_dlp_gui
 TEMPLATE = app
+CONFIG += c++17
 SOURCES += youtube_dlp_gui.cpp
+RESOURCES += youtube_dlp_gui.qrc
+# "qmake CONFIG+=werror" turns compiler warnings into errors, as the CI build does
+werror: QMAKE_CXXFLAGS += -Werror
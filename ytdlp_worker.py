@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+"""Warm yt-dlp worker used by youtube-dlp-gui.
+
+The GUI starts this script once and keeps it running, so the Python
+interpreter and the yt_dlp import are paid for once instead of per job.
+
+Protocol: one JSON object per line in both directions.
+
+Requests (stdin):
+    {"id": 1, "op": "ping"}
+    {"id": 2, "op": "probe", "urls": ["https://..."]}
+    {"id": 3, "op": "download", "args": ["-f", "best", "https://..."]}
+    {"id": 3, "op": "limit", "rate": 524288}
+    {"op": "exit"}
+
+"limit" changes the rate limit (bytes per second, 0 for unlimited) of the
+download with the same id while it runs; it is handled as soon as it
+arrives rather than after the download.
+
+Events (stdout):
+    {"event": "ready", "version": "...", "pid": 123}
+    {"id": 2, "event": "info", "url": "...", "info": {...}}
+    {"id": 2, "event": "error", "url": "...", "message": "..."}
+    {"id": 3, "event": "progress", "status": "downloading", ...}
+    {"id": 3, "event": "item_start", "video_id": "...", "url": "...", "title": "..."}
+    {"id": 3, "event": "postprocess", "status": "started", ...}
+    {"id": 3, "event": "item_done", "video_id": "...", "filepath": "..."}
+    {"id": 3, "event": "log", "level": "info", "message": "..."}
+    {"id": 3, "event": "done", "ok": true, "error": "", "rss_kb": 51200}
+
+yt-dlp's own console output is redirected to stderr so it can never
+corrupt the protocol stream.
+"""
+
+import json
+import os
+import queue
+import sys
+import threading
+
+try:
+    import resource
+except ImportError:  # Not available on Windows
+    resource = None
+
+import yt_dlp
+from yt_dlp.postprocessor import PostProcessor
+
+PROTOCOL = sys.stdout
+sys.stdout = sys.stderr
+
+# Fields the GUI reads from probe results, as in the GUI's ProbeReader: "[]" is
+# every list element and "*" any key. The rest (format fragments, HTTP headers,
+# thumbnail details, ...) is dropped before it crosses the pipe.
+PROBE_FIELDS = [
+    "id", "title", "duration", "uploader", "channel", "thumbnail", "_type", "original_url", "webpage_url",
+    "url", "filesize", "filesize_approx", "playlist_count",
+    "formats.[].format_id", "formats.[].ext", "formats.[].vcodec", "formats.[].acodec", "formats.[].height",
+    "formats.[].fps", "formats.[].tbr", "formats.[].abr", "formats.[].filesize", "formats.[].filesize_approx",
+    "entries.[].id", "entries.[].title", "entries.[].duration", "entries.[].url", "entries.[].webpage_url",
+    "entries.[].uploader", "entries.[].channel", "entries.[].thumbnail", "entries.[].thumbnails.[].url",
+    "entries.[].thumbnails.[].width", "thumbnails.[].url", "thumbnails.[].width",
+    "subtitles.*.[].name", "automatic_captions.*.[].name",
+    "chapters.[].start_time", "chapters.[].end_time", "chapters.[].title",
+]
+
+
+def build_selection(fields):
+    root = {}
+    for field in fields:
+        node = root
+        for part in field.split("."):
+            node = node.setdefault(part, {})
+    return root
+
+
+PROBE_SELECTION = build_selection(PROBE_FIELDS)
+
+
+def select(value, node):
+    """Keeps the parts of a value named by a selection node; an empty node keeps all."""
+    if not node:
+        return value
+    if isinstance(value, dict):
+        selected = {}
+        for key, item in value.items():
+            child = node.get(key, node.get("*"))
+            if child is not None:
+                selected[key] = select(item, child)
+        return selected
+    if isinstance(value, list):
+        child = node.get("[]")
+        return [select(item, child) for item in value] if child is not None else []
+    return value
+
+
+# The download in progress, so "limit" requests can reach its options
+CURRENT = {"id": None, "ydl": None}
+
+
+def send(event):
+    PROTOCOL.write(json.dumps(event, default=str) + "\n")
+    PROTOCOL.flush()
+
+
+def resident_kb():
+    """Current resident set size, used by the GUI to recycle bloated workers."""
+    try:
+        with open("/proc/self/statm") as statm:
+            pages = int(statm.read().split()[1])
+        return pages * os.sysconf("SC_PAGE_SIZE") // 1024
+    except (OSError, ValueError, IndexError):
+        if resource is None:
+            return 0
+        return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+
+
+class Logger:
+    """Forwards yt-dlp messages to the GUI as log events."""
+
+    def __init__(self, job_id):
+        self.job_id = job_id
+
+    def _send(self, level, message):
+        send({"id": self.job_id, "event": "log", "level": level, "message": message})
+
+    def debug(self, message):
+        # yt-dlp routes info-level messages through debug() without a prefix
+        if not message.startswith("[debug] "):
+            self._send("info", message)
+
+    def info(self, message):
+        self._send("info", message)
+
+    def warning(self, message):
+        self._send("warning", message)
+
+    def error(self, message):
+        self._send("error", message)
+
+
+def progress_hook(job_id):
+    def hook(status):
+        info = status.get("info_dict") or {}
+        send({
+            "id": job_id,
+            "event": "progress",
+            "status": status.get("status"),
+            "video_id": info.get("id"),
+            "filename": status.get("filename"),
+            "downloaded_bytes": status.get("downloaded_bytes"),
+            "total_bytes": status.get("total_bytes") or status.get("total_bytes_estimate"),
+            "speed": status.get("speed"),
+            "eta": status.get("eta"),
+            "fragment_index": status.get("fragment_index"),
+            "fragment_count": status.get("fragment_count"),
+        })
+    return hook
+
+
+def postprocessor_hook(job_id):
+    def hook(status):
+        info = status.get("info_dict") or {}
+        send({
+            "id": job_id,
+            "event": "postprocess",
+            "status": status.get("status"),
+            "postprocessor": status.get("postprocessor"),
+            "video_id": info.get("id"),
+            "filepath": info.get("filepath"),
+        })
+    return hook
+
+
+class ItemEventPP(PostProcessor):
+    """Reports item boundaries so one download job can serve many URLs."""
+
+    def __init__(self, job_id, event):
+        super().__init__(None)
+        self.job_id = job_id
+        self.event = event
+
+    def run(self, info):
+        send({
+            "id": self.job_id,
+            "event": self.event,
+            "video_id": info.get("id"),
+            "url": info.get("original_url"),
+            "title": info.get("title"),
+            "filepath": info.get("filepath"),
+        })
+        return [], info
+
+
+def run_probe(job_id, urls):
+    """Equivalent of "yt-dlp -J --flat-playlist" for each URL, one event per URL."""
+    options = {
+        "quiet": True,
+        "no_warnings": True,
+        "skip_download": True,
+        "extract_flat": "in_playlist",
+        "logger": Logger(job_id),
+    }
+    with yt_dlp.YoutubeDL(options) as ydl:
+        for url in urls:
+            try:
+                info = select(ydl.sanitize_info(ydl.extract_info(url, download=False)), PROBE_SELECTION)
+                send({"id": job_id, "event": "info", "url": url, "info": info})
+            except Exception as error:  # One bad URL must not fail the batch
+                send({"id": job_id, "event": "error", "url": url, "message": str(error)})
+    return True, ""
+
+
+def run_download(job_id, args):
+    """Runs a download from the same command-line arguments the yt-dlp binary takes."""
+    parsed = yt_dlp.parse_options(args)
+    options = dict(parsed.ydl_opts)
+    options.update({
+        "quiet": True,
+        "noprogress": True,
+        "logger": Logger(job_id),
+        "progress_hooks": [progress_hook(job_id)],
+        "postprocessor_hooks": [postprocessor_hook(job_id)],
+    })
+    with yt_dlp.YoutubeDL(options) as ydl:
+        ydl.add_post_processor(ItemEventPP(job_id, "item_start"), when="before_dl")
+        ydl.add_post_processor(ItemEventPP(job_id, "item_done"), when="after_move")
+        CURRENT.update(id=job_id, ydl=ydl)
+        try:
+            code = ydl.download(parsed.urls)
+        finally:
+            CURRENT.update(id=None, ydl=None)
+    return code == 0, "" if code == 0 else "yt-dlp returned %d" % code
+
+
+def read_requests(requests):
+    """Reads stdin on its own thread so "limit" applies while a download runs."""
+    for line in sys.stdin:
+        try:
+            request = json.loads(line)
+        except ValueError:
+            continue
+        if request.get("op") == "limit":
+            # The downloaders read params["ratelimit"] on every chunk
+            ydl = CURRENT["ydl"]
+            if ydl is not None and CURRENT["id"] == request.get("id"):
+                ydl.params["ratelimit"] = int(request.get("rate") or 0) or None
+            continue
+        requests.put(request)
+    requests.put({"op": "exit"})
+
+
+def main():
+    send({"event": "ready", "version": yt_dlp.version.__version__, "pid": os.getpid()})
+    requests = queue.Queue()
+    threading.Thread(target=read_requests, args=(requests,), daemon=True).start()
+    while True:
+        request = requests.get()
+        op = request.get("op")
+        job_id = request.get("id")
+        if op == "exit":
+            break
+        try:
+            if op == "ping":
+                ok, error = True, ""
+            elif op == "probe":
+                ok, error = run_probe(job_id, request.get("urls", []))
+            elif op == "download":
+                ok, error = run_download(job_id, request.get("args", []))
+            else:
+                ok, error = False, "unknown op %r" % op
+        except SystemExit as error:  # parse_options exits on bad arguments
+            ok, error = False, "invalid arguments (%s)" % error
+        except Exception as error:
+            ok, error = False, str(error)
+        send({"id": job_id, "event": "done", "ok": ok, "error": error, "rss_kb": resident_kb()})
+
+
+if __name__ == "__main__":
+    main()